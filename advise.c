@@ -0,0 +1,297 @@
+/*
+ * advise.c
+ *
+ * Candidate ranges come from the heatmap: runs of sequentially streamed pages
+ * (WILLNEED), runs of pages referenced once or cold (PAGEOUT, COLD), hot pages
+ * that were still evicted (mlock) and densely touched huge-page windows
+ * (HUGEPAGE). Each candidate except HUGEPAGE is scored by replaying the trace
+ * through an LRU what-if model twice, without and with the advice applied;
+ * the fault difference is the estimate. The model is LRU whatever policy
+ * produced the heatmap, since madvise hints act on the kernel's LRU lists.
+ * HUGEPAGE is scored by first touch: one fault replaces one per touched page.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "advise.h"
+
+void vm_advise_defaults(struct vm_advise_params *p) {
+    p->th.hot_refs = -1;
+    p->th.cold_refs = 1;
+    p->min_range = 4;
+    p->huge_pages = 512;
+    p->huge_density = 0.9;
+    p->max_advice = 32;
+}
+
+const char *vm_advice_name(enum vm_advice_kind kind) {
+    switch (kind) {
+    case VM_ADV_WILLNEED: return "MADV_WILLNEED";
+    case VM_ADV_COLD: return "MADV_COLD";
+    case VM_ADV_PAGEOUT: return "MADV_PAGEOUT";
+    case VM_ADV_MLOCK: return "mlock";
+    case VM_ADV_HUGEPAGE: return "MADV_HUGEPAGE";
+    }
+    return "?";
+}
+
+/* ---------------- LRU what-if model ---------------- */
+
+enum { ABSENT, LISTED, PINNED };
+
+/* Doubly linked LRU list over page numbers, head = most recently used */
+struct what_if {
+    int table_cnt;
+    int frames;
+    int *prev;
+    int *next;
+    unsigned char *where;
+    int head;
+    int tail;
+    int used;   /* frames held, pinned included */
+};
+
+static void list_unlink(struct what_if *w, int p) {
+    if (w->prev[p] >= 0) w->next[w->prev[p]] = w->next[p]; else w->head = w->next[p];
+    if (w->next[p] >= 0) w->prev[w->next[p]] = w->prev[p]; else w->tail = w->prev[p];
+}
+
+static void list_push_head(struct what_if *w, int p) {
+    w->prev[p] = -1;
+    w->next[p] = w->head;
+    if (w->head >= 0) w->prev[w->head] = p; else w->tail = p;
+    w->head = p;
+}
+
+static void list_push_tail(struct what_if *w, int p) {
+    w->next[p] = -1;
+    w->prev[p] = w->tail;
+    if (w->tail >= 0) w->next[w->tail] = p; else w->head = p;
+    w->tail = p;
+}
+
+static void drop_page(struct what_if *w, int p) {
+    list_unlink(w, p);
+    w->where[p] = ABSENT;
+    w->used--;
+}
+
+/* Make room for one page; 0, or -1 if every frame is pinned */
+static int make_room(struct what_if *w) {
+    if (w->used < w->frames) return 0;
+    if (w->tail < 0) return -1;
+    drop_page(w, w->tail);
+    return 0;
+}
+
+static int advised(const struct vm_advice *adv, int page, enum vm_advice_kind kind) {
+    return adv && adv->kind == kind && page >= adv->start && page < adv->end;
+}
+
+/* Fault count of refs under LRU with adv applied (adv may be NULL) */
+static long long simulate(struct what_if *w, const int *refs, int n, const struct vm_advice *adv) {
+    memset(w->where, ABSENT, (size_t)w->table_cnt);
+    w->head = w->tail = -1;
+    w->used = 0;
+    long long faults = 0;
+
+    for (int i = 0; i < n; ++i) {
+        int p = refs[i];
+        if (p < 0 || p >= w->table_cnt) {
+            faults++;
+            continue;
+        }
+        if (w->where[p] == PINNED) continue;
+        if (w->where[p] == LISTED) {
+            list_unlink(w, p);
+            if (advised(adv, p, VM_ADV_COLD)) list_push_tail(w, p); else list_push_head(w, p);
+            continue;
+        }
+
+        faults++;
+        if (advised(adv, p, VM_ADV_WILLNEED)) {
+            /* read the rest of the range in behind the faulting page, but never
+             * at the expense of pages of the same range */
+            for (int q = adv->start; q < adv->end; ++q) {
+                if (q == p || w->where[q] != ABSENT) continue;
+                if (w->used == w->frames && (w->tail < 0 || advised(adv, w->tail, VM_ADV_WILLNEED)))
+                    break;
+                make_room(w);
+                w->where[q] = LISTED;
+                w->used++;
+                list_push_head(w, q);
+            }
+        }
+        if (make_room(w) < 0) continue;
+        if (advised(adv, p, VM_ADV_PAGEOUT)) continue;   /* reclaimed right after use */
+        w->used++;
+        if (advised(adv, p, VM_ADV_MLOCK)) {
+            w->where[p] = PINNED;
+        } else {
+            w->where[p] = LISTED;
+            if (advised(adv, p, VM_ADV_COLD)) list_push_tail(w, p); else list_push_head(w, p);
+        }
+    }
+    return faults;
+}
+
+/* ---------------- candidates ---------------- */
+
+struct candidate {
+    struct vm_advice adv;
+    long long bound;    /* faults inside the range: no advice can save more */
+};
+
+struct candidates {
+    struct candidate *v;
+    int n;
+    int cap;
+};
+
+static int add_candidate(struct candidates *c, enum vm_advice_kind kind, int start, int end,
+                         long long bound) {
+    if (c->n == c->cap) {
+        int cap = c->cap ? 2 * c->cap : 64;
+        struct candidate *v = realloc(c->v, sizeof(*v) * (size_t)cap);
+        if (!v) return -1;
+        c->v = v;
+        c->cap = cap;
+    }
+    c->v[c->n].adv.kind = kind;
+    c->v[c->n].adv.start = start;
+    c->v[c->n].adv.end = end;
+    c->v[c->n].adv.est_fault_reduction = 0;
+    c->v[c->n].bound = bound;
+    c->n++;
+    return 0;
+}
+
+/* Add every run of pages with match[page] set that is at least min_len long,
+ * split into pieces of at most max_len pages */
+static int add_runs(struct candidates *c, const struct vm_heatmap *hm, const unsigned char *match,
+                    enum vm_advice_kind kind, int min_len, int max_len) {
+    for (int i = 0; i < hm->table_cnt;) {
+        if (!match[i]) {
+            i++;
+            continue;
+        }
+        int start = i;
+        long long bound = 0;
+        for (; i < hm->table_cnt && match[i] && i - start < max_len; ++i)
+            bound += hm->pages[i].faults;
+        if (i - start >= min_len && add_candidate(c, kind, start, i, bound) < 0) return -1;
+    }
+    return 0;
+}
+
+static int by_bound(const void *a, const void *b) {
+    const struct candidate *x = a, *y = b;
+    return (x->bound < y->bound) - (x->bound > y->bound);
+}
+
+static int by_estimate(const void *a, const void *b) {
+    const struct vm_advice *x = a, *y = b;
+    if (x->est_fault_reduction != y->est_fault_reduction)
+        return (x->est_fault_reduction < y->est_fault_reduction) -
+               (x->est_fault_reduction > y->est_fault_reduction);
+    return x->start - y->start;
+}
+
+static int collect_candidates(struct candidates *c, const struct vm_heatmap *hm, const int *refs,
+                              int n, int frames, const struct vm_advise_params *p,
+                              unsigned char *match) {
+    int tc = hm->table_cnt;
+    struct vm_heat_thresholds th = vm_heatmap_thresholds(hm, p->th);
+
+    /* streamed: at least half the references arrive straight after the page below */
+    int *seq = calloc(tc > 0 ? (size_t)tc : 1, sizeof(int));
+    if (!seq) return -1;
+    for (int i = 1; i < n; ++i)
+        if (refs[i] > 0 && refs[i] < tc && refs[i] == refs[i - 1] + 1) seq[refs[i]]++;
+    for (int i = 0; i < tc; ++i)
+        match[i] = hm->pages[i].faults > 1 && 2 * seq[i] >= hm->pages[i].references;
+    free(seq);
+    if (add_runs(c, hm, match, VM_ADV_WILLNEED, p->min_range, frames) < 0) return -1;
+
+    for (int i = 0; i < tc; ++i) match[i] = hm->pages[i].references == 1;
+    if (add_runs(c, hm, match, VM_ADV_PAGEOUT, p->min_range, tc) < 0) return -1;
+
+    for (int i = 0; i < tc; ++i)
+        match[i] = hm->pages[i].references > 1 &&
+                   vm_heatmap_classify(&hm->pages[i], &th) == VM_HEAT_COLD;
+    if (add_runs(c, hm, match, VM_ADV_COLD, p->min_range, tc) < 0) return -1;
+
+    /* pinning more than half the frames would starve everything else */
+    for (int i = 0; i < tc; ++i)
+        match[i] = hm->pages[i].evictions > 0 &&
+                   vm_heatmap_classify(&hm->pages[i], &th) == VM_HEAT_HOT;
+    if (frames >= 2 && add_runs(c, hm, match, VM_ADV_MLOCK, 1, frames / 2) < 0) return -1;
+
+    return 0;
+}
+
+/* ---------------- entry point ---------------- */
+
+int vm_advise(const struct vm_heatmap *hm, const int *refs, int reference_cnt, int frames,
+              const struct vm_advise_params *p, struct vm_advice **out) {
+    int tc = hm->table_cnt;
+    struct candidates c = { NULL, 0, 0 };
+    struct what_if w;
+    size_t cells = tc > 0 ? (size_t)tc : 1;
+    unsigned char *match = calloc(cells, 1);
+    w.table_cnt = tc;
+    w.frames = frames;
+    w.prev = malloc(sizeof(int) * cells);
+    w.next = malloc(sizeof(int) * cells);
+    w.where = malloc(cells);
+    int count = -1;
+    *out = NULL;
+    if (!match || !w.prev || !w.next || !w.where) goto done;
+
+    if (collect_candidates(&c, hm, refs, reference_cnt, frames, p, match) < 0) goto done;
+
+    /* only the most promising candidates are worth a replay each */
+    qsort(c.v, (size_t)c.n, sizeof(*c.v), by_bound);
+    int scored = c.n;
+    if (p->max_advice >= 0 && scored > 4 * p->max_advice) scored = 4 * p->max_advice;
+
+    int max_out = scored + (p->huge_pages > 1 ? tc / p->huge_pages + 1 : 0);
+    struct vm_advice *adv = malloc(sizeof(*adv) * (size_t)(max_out > 0 ? max_out : 1));
+    if (!adv) goto done;
+    count = 0;
+
+    long long baseline = simulate(&w, refs, reference_cnt, NULL);
+    for (int i = 0; i < scored; ++i) {
+        if (c.v[i].bound <= 0) continue;
+        struct vm_advice a = c.v[i].adv;
+        a.est_fault_reduction = baseline - simulate(&w, refs, reference_cnt, &a);
+        if (a.est_fault_reduction > 0) adv[count++] = a;
+    }
+
+    for (int base = 0; p->huge_pages > 1 && base < tc; base += p->huge_pages) {
+        int end = base + p->huge_pages < tc ? base + p->huge_pages : tc;
+        int touched = 0;
+        for (int i = base; i < end; ++i)
+            if (hm->pages[i].references) touched++;
+        if (touched > 1 && touched >= p->huge_density * p->huge_pages) {
+            adv[count].kind = VM_ADV_HUGEPAGE;
+            adv[count].start = base;
+            adv[count].end = end;
+            adv[count].est_fault_reduction = touched - 1;
+            count++;
+        }
+    }
+
+    qsort(adv, (size_t)count, sizeof(*adv), by_estimate);
+    if (p->max_advice >= 0 && count > p->max_advice) count = p->max_advice;
+    *out = adv;
+
+done:
+    free(c.v);
+    free(match);
+    free(w.prev);
+    free(w.next);
+    free(w.where);
+    return count;
+}
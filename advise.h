@@ -0,0 +1,46 @@
+/*
+ * advise.h
+ *
+ * madvise/mlock recommendations per virtual page range, derived from a
+ * heatmap replay, each with an estimated fault reduction.
+ */
+
+#ifndef ADVISE_H
+#define ADVISE_H
+
+#include "heatmap.h"
+
+enum vm_advice_kind {
+    VM_ADV_WILLNEED,    /* sequentially streamed range: prefetch on first fault */
+    VM_ADV_COLD,        /* rarely referenced: deactivate after use */
+    VM_ADV_PAGEOUT,     /* referenced once: reclaim right after use */
+    VM_ADV_MLOCK,       /* hot pages that were still evicted */
+    VM_ADV_HUGEPAGE,    /* densely touched huge-page-aligned window */
+};
+
+struct vm_advice {
+    enum vm_advice_kind kind;
+    int start;                      /* first page */
+    int end;                        /* one past the last page */
+    long long est_fault_reduction;
+};
+
+struct vm_advise_params {
+    struct vm_heat_thresholds th;   /* resolved with vm_heatmap_thresholds */
+    int min_range;                  /* shortest WILLNEED/COLD/PAGEOUT range, in pages */
+    int huge_pages;                 /* pages per huge page */
+    double huge_density;            /* touched fraction that makes a window dense */
+    int max_advice;                 /* keep this many, largest estimate first */
+};
+
+void vm_advise_defaults(struct vm_advise_params *p);
+
+/* Recommendations for the run summarised by hm (refs replayed with frames
+ * frames). *out is malloc'd; returns the count or -1. */
+int vm_advise(const struct vm_heatmap *hm, const int *refs, int reference_cnt, int frames,
+              const struct vm_advise_params *p, struct vm_advice **out);
+
+/* "MADV_WILLNEED", "mlock", ... */
+const char *vm_advice_name(enum vm_advice_kind kind);
+
+#endif /* ADVISE_H */
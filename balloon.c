@@ -0,0 +1,216 @@
+/*
+ * balloon.c
+ *
+ * Every guest is a vm_engine over its own page table and an identity pool
+ * of guest frames; guest g's frame f is entry g * guest_frames + f of the
+ * host's EPT, which the host engine pages under host swap. Under ballooning
+ * a guest's limit is its frames minus its balloon, enforced the way
+ * cgroup.c enforces memory.max: a fault at the limit evicts first.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "balloon.h"
+
+void vm_balloon_defaults(struct vm_balloon_params *p) {
+    p->mode = VM_OVERCOMMIT_BALLOON;
+    p->interval = 1000;
+    p->step = 4;
+    p->min_frames = 1;
+}
+
+struct guest {
+    struct vm_engine e;
+    struct PTE *pt;
+    struct vm_observer obs;
+    struct overcommit *oc;
+    int base;           /* first EPT entry */
+    int limit;          /* frames the guest may fill */
+    int init;           /* engine initialised */
+    long long window;   /* faults since the last adjustment */
+};
+
+struct overcommit {
+    struct guest *g;
+    int nguests;
+    struct vm_engine host;
+    int host_init;
+    struct PTE *ept;
+    unsigned char *swapped;     /* per EPT entry: host holds it in swap */
+    uint64_t evict_ns;          /* double paging within the current access */
+    int failed;
+    const struct vm_latency_costs *c;
+    struct vm_balloon_stats *st;
+};
+
+static void host_on_evict(void *ctx, int entry, int timestamp) {
+    struct overcommit *oc = ctx;
+    (void)timestamp;
+    oc->swapped[entry] = 1;
+}
+
+/* Touch a guest frame on the host; returns 1 for a swap-in, -1 on failure */
+static int host_touch(struct overcommit *oc, int entry, int timestamp) {
+    int r = vm_engine_access(&oc->host, entry, timestamp);
+    if (r < 0) {
+        oc->failed = 1;
+        return -1;
+    }
+    if (!r || !oc->swapped[entry]) return 0;
+    oc->swapped[entry] = 0;
+    oc->st->host_faults++;
+    return 1;
+}
+
+/* The guest writes the victim to its swap, which needs the frame on the host */
+static void guest_on_evict(void *ctx, int page, int timestamp) {
+    struct guest *g = ctx;
+    struct overcommit *oc = g->oc;
+    if (!oc->host_init) return;
+    if (host_touch(oc, g->base + g->pt[page].frame_number, timestamp) == 1) {
+        oc->st->double_paging++;
+        oc->evict_ns += oc->c->fault;
+    }
+}
+
+/* Evict g down to its limit */
+static int shrink(struct guest *g, int timestamp) {
+    int n = 0;
+    while (g->e.resident > g->limit) {
+        if (vm_engine_evict(&g->e, timestamp) < 0) return -1;
+        n++;
+    }
+    return n;
+}
+
+/* Move step frames from the guest that faulted least to the one that faulted
+ * most over the last interval */
+static int adjust(struct overcommit *oc, const struct vm_balloon_params *p, int guest_frames,
+                  int timestamp) {
+    struct guest *give = NULL, *take = NULL;
+    for (int i = 0; i < oc->nguests; ++i) {
+        struct guest *g = &oc->g[i];
+        if (g->limit + p->step <= guest_frames && (!take || g->window > take->window)) take = g;
+        if (g->limit - p->step >= p->min_frames && (!give || g->window < give->window)) give = g;
+    }
+    int move = give && take && give != take && give->window < take->window;
+    for (int i = 0; i < oc->nguests; ++i) oc->g[i].window = 0;
+    if (!move) return 0;
+    give->limit -= p->step;
+    take->limit += p->step;
+    int n = shrink(give, timestamp);
+    if (n < 0) return -1;
+    oc->st->adjustments++;
+    oc->st->ballooned += n;
+    oc->st->inflate_ns += (double)n * (double)oc->c->reclaim;
+    return 0;
+}
+
+static int *identity_pool(int cnt) {
+    int *pool = malloc(sizeof(int) * (size_t)(cnt > 0 ? cnt : 1));
+    for (int f = 0; pool && f < cnt; ++f) pool[f] = f;
+    return pool;
+}
+
+int vm_balloon_run(const struct vm_policy_ops *guest, const int *const *refs, int nguests,
+                   int reference_cnt, int table_cnt, int guest_frames,
+                   const struct vm_policy_ops *host, int host_frames,
+                   const struct vm_latency_costs *c, const struct vm_balloon_params *p,
+                   struct vm_hdr *h, struct vm_balloon_stats *stats) {
+    struct overcommit oc;
+    memset(stats, 0, sizeof(*stats));
+    memset(&oc, 0, sizeof(oc));
+    if (table_cnt <= 0 || nguests <= 0) return 0;
+    if (guest_frames < 0 || host_frames < nguests ||
+        (long long)reference_cnt * nguests >= 0x7fffffff ||
+        (long long)guest_frames * nguests >= 0x7fffffff)
+        return -1;
+    oc.nguests = nguests;
+    oc.c = c;
+    oc.st = stats;
+    int entries = guest_frames * nguests;
+    oc.g = calloc((size_t)nguests, sizeof(struct guest));
+    int *gpool = identity_pool(guest_frames);
+    int *hpool = identity_pool(host_frames);
+    int rc = -1;
+    if (!oc.g || !gpool || !hpool) goto done;
+
+    /* an even split of the host, or all of each guest under host swap */
+    int share = p->mode == VM_OVERCOMMIT_BALLOON ? host_frames / nguests : guest_frames;
+    for (int i = 0; i < nguests; ++i) {
+        struct guest *g = &oc.g[i];
+        g->oc = &oc;
+        g->base = i * guest_frames;
+        g->limit = share + (p->mode == VM_OVERCOMMIT_BALLOON && i < host_frames % nguests);
+        if (g->limit > guest_frames) g->limit = guest_frames;
+        g->pt = calloc((size_t)table_cnt, sizeof(struct PTE));
+        if (!g->pt || vm_engine_init(&g->e, guest, g->pt, table_cnt, gpool, guest_frames) < 0)
+            goto done;
+        g->init = 1;
+        g->obs.ctx = g;
+        g->obs.on_evict = guest_on_evict;
+        g->e.obs = &g->obs;
+    }
+    struct vm_observer hobs = { &oc, NULL, host_on_evict };
+    if (p->mode == VM_OVERCOMMIT_SWAP) {
+        oc.ept = calloc((size_t)(entries > 0 ? entries : 1), sizeof(struct PTE));
+        oc.swapped = calloc((size_t)(entries > 0 ? entries : 1), 1);
+        if (!oc.ept || !oc.swapped ||
+            vm_engine_init(&oc.host, host, oc.ept, entries, hpool, host_frames) < 0)
+            goto done;
+        oc.host_init = 1;
+        oc.host.obs = &hobs;
+    }
+
+    for (int i = 0; i < reference_cnt && !oc.failed; ++i) {
+        for (int k = 0; k < nguests && !oc.failed; ++k) {
+            struct guest *g = &oc.g[k];
+            int page = refs[k][i];
+            int timestamp = i * nguests + k + 1;
+            int in_table = page >= 0 && page < table_cnt;
+            uint64_t ns = c->hit;
+            oc.evict_ns = 0;
+            if (in_table && !g->pt[page].is_valid && g->e.resident >= g->limit) {
+                while (g->e.resident >= g->limit && g->e.resident > 0) {
+                    if (vm_engine_evict(&g->e, timestamp) < 0) {
+                        oc.failed = 1;
+                        break;
+                    }
+                    ns += c->reclaim;
+                }
+                if (oc.failed) break;
+            }
+            int r = vm_engine_access(&g->e, page, timestamp);
+            if (r < 0) {
+                oc.failed = 1;
+                break;
+            }
+            if (r) {
+                ns += c->fault;
+                stats->guest_faults++;
+                g->window++;
+            }
+            if (oc.host_init && in_table && g->pt[page].is_valid &&
+                host_touch(&oc, g->base + g->pt[page].frame_number, timestamp) == 1)
+                ns += c->fault;
+            vm_hdr_record(h, ns + oc.evict_ns);
+        }
+        if (!oc.failed && p->mode == VM_OVERCOMMIT_BALLOON && p->step > 0 && p->interval > 0 &&
+            (i + 1) % p->interval == 0 && adjust(&oc, p, guest_frames, (i + 1) * nguests) < 0)
+            oc.failed = 1;
+    }
+    rc = oc.failed ? -1 : (int)stats->guest_faults;
+done:
+    for (int i = 0; oc.g && i < nguests; ++i) {
+        if (oc.g[i].init) vm_engine_destroy(&oc.g[i].e);
+        free(oc.g[i].pt);
+    }
+    if (oc.host_init) vm_engine_destroy(&oc.host);
+    free(oc.g);
+    free(oc.ept);
+    free(oc.swapped);
+    free(gpool);
+    free(hpool);
+    return rc;
+}
@@ -0,0 +1,60 @@
+/*
+ * balloon.h
+ *
+ * Memory overcommit across several guests sharing one host. Each guest runs
+ * its own policy over guest_frames guest physical frames; together they may
+ * claim more than the host's host_frames. Two ways to make that fit:
+ *
+ *   - host swap: guests keep all their frames and the host pages guest
+ *     frames out behind their backs under its own policy, so a guest
+ *     evicting a page the host already swapped out pays for double paging;
+ *   - balloon: the host never swaps. It splits its frames between the guests
+ *     and inflates a guest's balloon to take frames back, which makes that
+ *     guest evict through its own policy, and deflates it to hand them out.
+ *     Every interval rounds, step frames move from the guest that faulted
+ *     least to the one that faulted most.
+ *
+ * Both modes charge every access with the vm_latency_costs model (hit,
+ * fault, and reclaim for a synchronous eviction; host swap-ins are faults).
+ */
+
+#ifndef BALLOON_H
+#define BALLOON_H
+
+#include "latency.h"
+
+enum vm_overcommit_mode {
+    VM_OVERCOMMIT_SWAP,
+    VM_OVERCOMMIT_BALLOON,
+};
+
+struct vm_balloon_params {
+    enum vm_overcommit_mode mode;
+    int interval;       /* rounds (one reference per guest) between adjustments */
+    int step;           /* frames moved per adjustment, 0 for a fixed split */
+    int min_frames;     /* no balloon takes a guest below this */
+};
+
+void vm_balloon_defaults(struct vm_balloon_params *p);
+
+struct vm_balloon_stats {
+    long long guest_faults;
+    long long host_faults;      /* host swap-ins of guest frames */
+    long long double_paging;    /* of those, taken to let a guest evict */
+    long long ballooned;        /* pages guests evicted to inflate a balloon */
+    long long adjustments;
+    double inflate_ns;          /* reclaim charged to balloon inflation */
+};
+
+/* Replay refs[g] (reference_cnt pages each, below table_cnt) for nguests
+ * guests round-robin, one reference per guest per round, on host_frames
+ * host frames. Access latencies go to h (initialised by the caller). Returns
+ * the guest fault count, or -1 if allocation fails, the host has fewer
+ * frames than guests, or a policy finds no victim. */
+int vm_balloon_run(const struct vm_policy_ops *guest, const int *const *refs, int nguests,
+                   int reference_cnt, int table_cnt, int guest_frames,
+                   const struct vm_policy_ops *host, int host_frames,
+                   const struct vm_latency_costs *c, const struct vm_balloon_params *p,
+                   struct vm_hdr *h, struct vm_balloon_stats *stats);
+
+#endif /* BALLOON_H */
@@ -0,0 +1,193 @@
+/*
+ * belady.c
+ *
+ * The FIFO queue holds resident pages in arrival order, which is the order
+ * choose_fifo_victim evicts them in on a fresh table (arrival timestamps are
+ * distinct), so counts match count_page_faults_fifo.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "belady.h"
+
+struct fifo {
+    int *queue;     /* ring of resident pages, oldest at head */
+    int head;
+    int cnt;
+    int frames;
+    unsigned char *resident;
+    int table_cnt;
+};
+
+static int fifo_init(struct fifo *f, int table_cnt, int frames) {
+    f->queue = malloc(sizeof(int) * (size_t)(frames > 0 ? frames : 1));
+    f->resident = calloc(table_cnt > 0 ? (size_t)table_cnt : 1, 1);
+    f->head = 0;
+    f->cnt = 0;
+    f->frames = frames;
+    f->table_cnt = table_cnt;
+    if (f->queue && f->resident) return 0;
+    free(f->queue);
+    free(f->resident);
+    return -1;
+}
+
+static void fifo_free(struct fifo *f) {
+    free(f->queue);
+    free(f->resident);
+}
+
+/* 1 on fault */
+static int fifo_access(struct fifo *f, int page) {
+    if (page < 0 || page >= f->table_cnt) return 1;
+    if (f->resident[page]) return 0;
+    if (f->frames <= 0) return 1;
+    if (f->cnt == f->frames) {
+        f->resident[f->queue[f->head]] = 0;
+        f->queue[f->head] = page;
+        f->head = (f->head + 1) % f->frames;
+    } else {
+        f->queue[(f->head + f->cnt++) % f->frames] = page;
+    }
+    f->resident[page] = 1;
+    return 1;
+}
+
+int vm_fifo_faults(const int *refs, int reference_cnt, int table_cnt, int frames,
+                   unsigned char *resident) {
+    struct fifo f;
+    if (fifo_init(&f, table_cnt, frames) < 0) return -1;
+    int faults = 0;
+    for (int i = 0; i < reference_cnt; ++i) faults += fifo_access(&f, refs[i]);
+    if (resident) memcpy(resident, f.resident, (size_t)(table_cnt > 0 ? table_cnt : 0));
+    fifo_free(&f);
+    return faults;
+}
+
+/* ---------------- parallel sweep ---------------- */
+
+struct sweep {
+    const int *refs;
+    int reference_cnt;
+    int table_cnt;
+    const int *frames;
+    int nframes;
+    long long *faults;
+    int next;
+    int failed;
+    pthread_mutex_t lock;
+};
+
+static void *sweep_worker(void *arg) {
+    struct sweep *s = arg;
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        int idx = s->next < s->nframes ? s->next++ : -1;
+        pthread_mutex_unlock(&s->lock);
+        if (idx < 0) return NULL;
+        int faults = vm_fifo_faults(s->refs, s->reference_cnt, s->table_cnt, s->frames[idx], NULL);
+        s->faults[idx] = faults;
+        if (faults < 0) {
+            pthread_mutex_lock(&s->lock);
+            s->failed = 1;
+            pthread_mutex_unlock(&s->lock);
+        }
+    }
+}
+
+int vm_fifo_sweep(const int *refs, int reference_cnt, int table_cnt,
+                  const int *frames, int nframes, int nthreads, long long *faults) {
+    struct sweep s = { refs, reference_cnt, table_cnt, frames, nframes, faults, 0, 0,
+                       PTHREAD_MUTEX_INITIALIZER };
+    pthread_t tids[256];
+    int started = 0;
+    if (nthreads > nframes) nthreads = nframes;
+    if (nthreads > 256) nthreads = 256;
+    for (int i = 1; i < nthreads; ++i)
+        if (pthread_create(&tids[started], NULL, sweep_worker, &s) == 0) started++;
+    sweep_worker(&s);
+    for (int i = 0; i < started; ++i) pthread_join(tids[i], NULL);
+    pthread_mutex_destroy(&s.lock);
+    return s.failed ? -1 : 0;
+}
+
+/* ---------------- shrinking ---------------- */
+
+/* Length of the shortest prefix on which large faults more than small, 0 if
+ * none, -1 if out of memory. Both queues run in lockstep, so this is one pass. */
+static int anomalous_prefix(const int *refs, int n, int table_cnt, int small, int large) {
+    struct fifo a, b;
+    if (fifo_init(&a, table_cnt, small) < 0) return -1;
+    if (fifo_init(&b, table_cnt, large) < 0) {
+        fifo_free(&a);
+        return -1;
+    }
+    int fa = 0, fb = 0, len = 0;
+    for (int i = 0; i < n && !len; ++i) {
+        fa += fifo_access(&a, refs[i]);
+        fb += fifo_access(&b, refs[i]);
+        if (fb > fa) len = i + 1;
+    }
+    fifo_free(&a);
+    fifo_free(&b);
+    return len;
+}
+
+int vm_belady_shrink(const int *refs, int reference_cnt, int table_cnt, struct vm_anomaly *a) {
+    int small = a->small, large = a->large;
+    int n = anomalous_prefix(refs, reference_cnt, table_cnt, small, large);
+    if (n <= 0) return -1;
+    int *r = malloc(sizeof(int) * (size_t)n);
+    int *t = malloc(sizeof(int) * (size_t)n);
+    if (!r || !t) {
+        free(r);
+        free(t);
+        return -1;
+    }
+    memcpy(r, refs, sizeof(int) * (size_t)n);
+
+    int progress = 1;
+    while (progress && n > 0) {
+        progress = 0;
+        for (int chunk = n / 2 > 0 ? n / 2 : 1; chunk >= 1 && n > 0; chunk /= 2) {
+            for (int start = 0; start + chunk <= n;) {
+                int m = n - chunk;
+                memcpy(t, r, sizeof(int) * (size_t)start);
+                memcpy(t + start, r + start + chunk, sizeof(int) * (size_t)(m - start));
+                int len = anomalous_prefix(t, m, table_cnt, small, large);
+                if (len < 0) {
+                    n = -1;
+                    break;
+                }
+                if (len > 0) {
+                    memcpy(r, t, sizeof(int) * (size_t)len);
+                    n = len;
+                    progress = 1;
+                } else {
+                    start += chunk;
+                }
+            }
+        }
+        /* the same shape often survives with fewer frames on both sides */
+        while (n > 0 && small > 1) {
+            int len = anomalous_prefix(r, n, table_cnt, small - 1, large - 1);
+            if (len == 0) break;
+            n = len;
+            small--;
+            large--;
+            progress = 1;
+        }
+    }
+    free(t);
+    if (n < 0) {
+        free(r);
+        return -1;
+    }
+    a->refs = r;
+    a->reference_cnt = n;
+    a->repro_small = small;
+    a->repro_large = large;
+    return 0;
+}
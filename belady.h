@@ -0,0 +1,40 @@
+/*
+ * belady.h
+ *
+ * Belady's anomaly detector. FIFO is not a stack algorithm, so adding a frame
+ * can add faults; this scans frame counts with a queue-based FIFO (O(1) per
+ * reference, fresh page table) on several threads, and shrinks each anomaly
+ * to a short reference string that still shows it.
+ */
+
+#ifndef BELADY_H
+#define BELADY_H
+
+/* FIFO fault count on a fresh table; references outside [0, table_cnt) fault
+ * without being loaded. If resident is not NULL it receives the final resident
+ * set (table_cnt flags). Returns -1 if out of memory. */
+int vm_fifo_faults(const int *refs, int reference_cnt, int table_cnt, int frames,
+                   unsigned char *resident);
+
+/* faults[i] = vm_fifo_faults(..., frames[i]) on up to nthreads threads; 0 or -1 */
+int vm_fifo_sweep(const int *refs, int reference_cnt, int table_cnt,
+                  const int *frames, int nframes, int nthreads, long long *faults);
+
+struct vm_anomaly {
+    int small;              /* frames */
+    int large;              /* more frames, yet ... */
+    long long small_faults;
+    long long large_faults; /* ... more faults */
+    int *refs;              /* minimal reproducer, malloc'd */
+    int reference_cnt;
+    int repro_small;        /* frame counts the reproducer shows it at */
+    int repro_large;
+};
+
+/* Shrink an anomaly between small and large frames: cut to the shortest
+ * anomalous prefix, drop chunks while the anomaly survives, then lower both
+ * frame counts together. Fills a->refs and the repro_* fields; returns 0, or
+ * -1 if out of memory or refs holds no such anomaly. */
+int vm_belady_shrink(const int *refs, int reference_cnt, int table_cnt, struct vm_anomaly *a);
+
+#endif /* BELADY_H */
@@ -0,0 +1,24 @@
+#!/bin/sh
+# Per-policy wall time of two vmsim builds over the same traces.
+#
+#   bench/compare.sh BASELINE CANDIDATE "VMSIM FLAGS" TRACE...
+#
+# Both binaries run with -j1 so timings are not skewed by scheduling.
+
+base=$1
+cand=$2
+flags=$3
+shift 3
+
+for t in "$@"; do
+    "$base" -j1 $flags "$t" | awk -v tag=base '!/^#/ && NR > 2 { print tag, $1, $5 }'
+    "$cand" -j1 $flags "$t" | awk -v tag=cand '!/^#/ && NR > 2 { print tag, $1, $5 }'
+done | awk '
+    { ms[$1, $2] += $3; seen[$2] = 1 }
+    END {
+        printf "%-10s %12s %12s %8s\n", "policy", "base_ms", "cand_ms", "speedup"
+        for (p in seen) {
+            speedup = ms["cand", p] > 0 ? ms["base", p] / ms["cand", p] : 0
+            printf "%-10s %12.1f %12.1f %7.2fx\n", p, ms["base", p], ms["cand", p], speedup
+        }
+    }'
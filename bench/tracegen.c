@@ -0,0 +1,87 @@
+/*
+ * tracegen.c
+ *
+ * Deterministic synthetic traces for the benchmark and PGO training runs.
+ *
+ *     tracegen KIND [REFERENCES [PAGES [SEED]]]
+ *
+ * loop   cyclic sweep over all pages (the case where MRU beats LRU)
+ * zipf   skewed popularity, rank r drawn with weight 1/r
+ * scan   80% hot set (10% of pages) mixed with long sequential scans
+ * phase  working set that moves every REFERENCES/8 references
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned int prng;
+
+static unsigned int next_rand(void) {
+    prng ^= prng << 13;
+    prng ^= prng >> 17;
+    prng ^= prng << 5;
+    return prng;
+}
+
+static double next_unit(void) {
+    return (next_rand() >> 8) / (double)(1u << 24);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: tracegen loop|zipf|scan|phase [REFERENCES [PAGES [SEED]]]\n");
+        return 1;
+    }
+    const char *kind = argv[1];
+    long refs = argc > 2 ? atol(argv[2]) : 200000;
+    int pages = argc > 3 ? atoi(argv[3]) : 1024;
+    prng = argc > 4 ? (unsigned int)strtoul(argv[4], NULL, 10) : 12345u;
+    if (prng == 0) prng = 12345u;
+    if (refs < 0 || pages < 1) {
+        fprintf(stderr, "tracegen: bad size\n");
+        return 1;
+    }
+
+    if (strcmp(kind, "loop") == 0) {
+        for (long i = 0; i < refs; ++i) printf("%ld\n", i % pages);
+    } else if (strcmp(kind, "zipf") == 0) {
+        double *cdf = malloc(sizeof(double) * (size_t)pages);
+        if (!cdf) return 1;
+        double sum = 0.0;
+        for (int r = 0; r < pages; ++r) cdf[r] = (sum += 1.0 / (r + 1));
+        for (long i = 0; i < refs; ++i) {
+            double u = next_unit() * sum;
+            int lo = 0, hi = pages - 1;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (cdf[mid] < u) lo = mid + 1;
+                else hi = mid;
+            }
+            printf("%d\n", lo);
+        }
+        free(cdf);
+    } else if (strcmp(kind, "scan") == 0) {
+        int hot = pages / 10 > 0 ? pages / 10 : 1;
+        int cursor = hot;
+        for (long i = 0; i < refs; ++i) {
+            if (next_rand() % 10 < 8) {
+                printf("%u\n", next_rand() % (unsigned int)hot);
+            } else {
+                printf("%d\n", cursor);
+                cursor = cursor + 1 < pages ? cursor + 1 : hot;
+            }
+        }
+    } else if (strcmp(kind, "phase") == 0) {
+        long phase_len = refs / 8 > 0 ? refs / 8 : 1;
+        int ws = pages / 8 > 0 ? pages / 8 : 1;
+        for (long i = 0; i < refs; ++i) {
+            int base = (int)((i / phase_len) * ws / 2 % pages);
+            printf("%u\n", (base + next_rand() % (unsigned int)ws) % (unsigned int)pages);
+        }
+    } else {
+        fprintf(stderr, "tracegen: unknown kind '%s'\n", kind);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,681 @@
+/*
+ * verify.c
+ *
+ * Differential check of the fast engines against the original scanners.
+ *
+ *     vmverify [-n ITERATIONS] [-s SEED] [-m MAX_REFS]
+ *
+ * The oracle_* functions below are the counting loops as they stood before any
+ * optimisation: a full PTE scan per fault, no dispatch. Every engine runs on
+ * randomised traces (some stepping outside the table, which counts as a fault),
+ * table sizes and frame pool orders, and must produce the same fault count
+ * and the same resident page set as its oracle. A mismatch is shrunk (drop
+ * reference chunks, then frames) to a minimal reproducer, printed, and the
+ * exit status is 1. A few fixed traces check statistics worked out by hand.
+ * Run once per VMSIM_SIMD setting to cover every kernel variant.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <getopt.h>
+
+#include "oslabs.h"
+#include "vm_engine.h"
+#include "vm_simd.h"
+#include "stackdist.h"
+#include "belady.h"
+#include "frametab.h"
+#include "hashpt.h"
+#include "pagesize.h"
+#include "thp.h"
+#include "ksm.h"
+#include "nested.h"
+#include "balloon.h"
+
+#define MAX_TABLE 96
+
+struct vcase {
+    int *refs;
+    int n;
+    int table_cnt;
+    int frames;
+    unsigned int pool_seed;   /* order of the initial frame pool */
+    int out_of_range;         /* some references fall outside the table */
+};
+
+struct outcome {
+    int faults;
+    unsigned char valid[MAX_TABLE];
+};
+
+/* ---------------- oracle (original scanners) ---------------- */
+
+static int oracle_pop_frame(int *frame_pool, int *frame_cnt) {
+    int fn = frame_pool[0];
+    for (int i = 1; i < *frame_cnt; ++i) frame_pool[i-1] = frame_pool[i];
+    (*frame_cnt)--;
+    return fn;
+}
+
+/* key: 0 = arrival (FIFO), 1 = last access (LRU), 2 = refcount (LFU), 3 = -last access (MRU) */
+static int oracle_victim(struct PTE *page_table, int table_cnt, int key) {
+    int victim = -1;
+    long best = LONG_MAX;
+    int best_arr = INT_MAX;
+    int best_frame = INT_MAX;
+    for (int i = 0; i < table_cnt; ++i) {
+        if (!page_table[i].is_valid) continue;
+        long k = key == 0 ? page_table[i].arrival_timestamp
+               : key == 1 ? page_table[i].last_access_timestamp
+               : key == 2 ? page_table[i].reference_count
+               : -(long)page_table[i].last_access_timestamp;
+        int at = page_table[i].arrival_timestamp;
+        int fn = page_table[i].frame_number;
+        if (k < best || (k == best && at < best_arr) ||
+            (k == best && at == best_arr && fn < best_frame)) {
+            best = k;
+            best_arr = at;
+            best_frame = fn;
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+static int oracle_count(struct PTE *page_table, int table_cnt, int *refs, int n,
+                        int *frame_pool, int frame_cnt, int key) {
+    int faults = 0;
+    for (int i = 0; i < n; ++i) {
+        int page = refs[i];
+        int timestamp = i + 1;
+        if (page < 0 || page >= table_cnt) {
+            faults++;
+            continue;
+        }
+        if (page_table[page].is_valid) {
+            page_table[page].last_access_timestamp = timestamp;
+            page_table[page].reference_count += 1;
+            continue;
+        }
+        faults++;
+        int fn;
+        if (frame_cnt > 0) {
+            fn = oracle_pop_frame(frame_pool, &frame_cnt);
+        } else {
+            int victim = oracle_victim(page_table, table_cnt, key);
+            if (victim < 0) continue;   /* no frames at all */
+            fn = page_table[victim].frame_number;
+            page_table[victim].is_valid = 0;
+        }
+        page_table[page].is_valid = 1;
+        page_table[page].frame_number = fn;
+        page_table[page].arrival_timestamp = timestamp;
+        page_table[page].last_access_timestamp = timestamp;
+        page_table[page].reference_count = 1;
+    }
+    return faults;
+}
+
+static int oracle_fifo(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { return oracle_count(pt, tc, r, n, fp, fc, 0); }
+static int oracle_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { return oracle_count(pt, tc, r, n, fp, fc, 1); }
+static int oracle_lfu(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { return oracle_count(pt, tc, r, n, fp, fc, 2); }
+static int oracle_mru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { return oracle_count(pt, tc, r, n, fp, fc, 3); }
+
+/* Belady's MIN: on a full pool, evict the page whose next use is farthest */
+static int oracle_opt(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) {
+    int faults = 0;
+    int used = 0;
+    (void)fp;
+    for (int i = 0; i < n; ++i) {
+        if (r[i] >= 0 && r[i] < tc && pt[r[i]].is_valid) continue;
+        faults++;
+        if (fc <= 0 || r[i] < 0 || r[i] >= tc) continue;
+        if (used < fc) {
+            used++;
+        } else {
+            int victim = -1, farthest = -1;
+            for (int p = 0; p < tc; ++p) {
+                if (!pt[p].is_valid) continue;
+                int j = i + 1;
+                while (j < n && r[j] != p) j++;
+                if (j > farthest) {
+                    farthest = j;
+                    victim = p;
+                }
+            }
+            pt[victim].is_valid = 0;
+        }
+        pt[r[i]].is_valid = 1;
+    }
+    return faults;
+}
+
+/* ---------------- engines under test ---------------- */
+
+typedef int (*count_fn)(struct PTE *page_table, int table_cnt, int *refs, int n,
+                        int *frame_pool, int frame_cnt);
+
+/* The generic engine: a copy of the built-in vtable is not recognised as
+ * built-in, so vm_policy_run drives it through the callbacks */
+static int via_vtable(const char *name, struct PTE *pt, int tc, int *r, int n, int *fp, int fc) {
+    struct vm_policy_ops ops = *vm_policy_find(name);
+    return vm_policy_run(&ops, pt, tc, r, n, fp, fc);
+}
+
+static int vt_fifo(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { return via_vtable("fifo", pt, tc, r, n, fp, fc); }
+static int vt_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { return via_vtable("lru", pt, tc, r, n, fp, fc); }
+static int vt_lfu(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { return via_vtable("lfu", pt, tc, r, n, fp, fc); }
+static int vt_mru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { return via_vtable("mru", pt, tc, r, n, fp, fc); }
+static int vt_random(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { return via_vtable("random", pt, tc, r, n, fp, fc); }
+
+/* a zero state cap forces the compact state of every policy that has one */
+static int compact_random(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) {
+    return vm_policy_run_capped(vm_policy_find("random"), pt, tc, r, n, fp, fc, 0);
+}
+
+typedef int (*access_fn)(struct PTE *page_table, int *table_cnt, int page_number,
+                         int *frame_pool, int *frame_cnt, int current_timestamp);
+
+static int via_access(access_fn fn, struct PTE *pt, int tc, int *r, int n, int *fp, int fc) {
+    int faults = 0;
+    for (int i = 0; i < n; ++i) {
+        if (r[i] < 0 || r[i] >= tc || !pt[r[i]].is_valid) faults++;
+        fn(pt, &tc, r[i], fp, &fc, i + 1);
+    }
+    return faults;
+}
+
+static int acc_fifo(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { return via_access(process_page_access_fifo, pt, tc, r, n, fp, fc); }
+static int acc_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { return via_access(process_page_access_lru, pt, tc, r, n, fp, fc); }
+static int acc_lfu(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { return via_access(process_page_access_lfu, pt, tc, r, n, fp, fc); }
+
+/* queue-based FIFO of the Belady scanner; its resident set is copied back */
+static int queue_fifo(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) {
+    unsigned char resident[MAX_TABLE];
+    (void)fp;
+    int faults = vm_fifo_faults(r, n, tc, fc, resident);
+    for (int p = 0; p < tc; ++p) pt[p].is_valid = resident[p];
+    return faults;
+}
+
+static int via_stack(enum vm_stack_kind kind, int tc, int *r, int n, int fc) {
+    struct vm_stack_profile sp;
+    if (vm_stack_profile_build(&sp, kind, r, n, tc) < 0) return -1;
+    int faults = (int)vm_stack_faults(&sp, fc);
+    vm_stack_profile_free(&sp);
+    return faults;
+}
+
+static int stack_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)pt; (void)fp; return via_stack(VM_STACK_LRU, tc, r, n, fc); }
+static int stack_opt(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)pt; (void)fp; return via_stack(VM_STACK_OPT, tc, r, n, fc); }
+
+/* starts at one bucket so inserts exercise kicks and incremental resizes */
+static int hashed_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) {
+    struct vm_hpt h;
+    (void)fp;
+    if (vm_hpt_init(&h, 1) < 0) return -1;
+    int faults = vm_hpt_lru_run(&h, r, NULL, n, fc);
+    for (int p = 0; p < tc; ++p) pt[p].is_valid = vm_hpt_lookup(&h, 0, p) >= 0;
+    vm_hpt_free(&h);
+    return faults;
+}
+
+/* pages become 4K-aligned byte addresses at a single page size */
+static int pagesize_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) {
+    struct vm_pagesize_result res = { .shift = 12 };
+    uint64_t *addrs = malloc(sizeof(uint64_t) * (size_t)(n > 0 ? n : 1));
+    (void)pt; (void)tc; (void)fp;
+    if (!addrs) return -1;
+    for (int i = 0; i < n; ++i) addrs[i] = (uint64_t)r[i] << 12 | (uint64_t)(i & 0xfff);
+    int rc = vm_pagesize_run(addrs, n, (uint64_t)fc << 12, &res, 1, NULL);
+    free(addrs);
+    return rc < 0 ? -1 : (int)res.faults;
+}
+
+/* base pages only: the buddy allocator must not change what gets evicted */
+static int via_buddy(struct PTE *pt, int tc, int *r, int n, int fc, int lru) {
+    struct vm_thp_params p = { 0, lru, VM_COMPACT_NONE, 0, 1 };
+    struct vm_thp_stats st;
+    return vm_thp_run(pt, tc, r, n, fc, &p, &st);
+}
+
+static int buddy_fifo(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)fp; return via_buddy(pt, tc, r, n, fc, 0); }
+static int buddy_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)fp; return via_buddy(pt, tc, r, n, fc, 1); }
+
+/* huge pages have no scanning oracle: a run that checks the allocator, owner
+ * map and list invariants at every reference must match one that does not */
+static int via_thp(struct PTE *pt, int tc, int *r, int n, int fc, int lru, int compact, int check) {
+    struct vm_thp_params p = { 2, lru, compact, 8, check };
+    struct vm_thp_stats st;
+    return vm_thp_run(pt, tc, r, n, fc, &p, &st);
+}
+
+static int thp_fifo(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)fp; return via_thp(pt, tc, r, n, fc, 0, VM_COMPACT_NONE, 0); }
+static int thp_fifo_checked(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)fp; return via_thp(pt, tc, r, n, fc, 0, VM_COMPACT_NONE, 1); }
+static int thp_direct(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)fp; return via_thp(pt, tc, r, n, fc, 1, VM_COMPACT_DIRECT, 0); }
+static int thp_direct_checked(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)fp; return via_thp(pt, tc, r, n, fc, 1, VM_COMPACT_DIRECT, 1); }
+static int thp_background(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)fp; return via_thp(pt, tc, r, n, fc, 1, VM_COMPACT_BACKGROUND, 0); }
+static int thp_background_checked(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)fp; return via_thp(pt, tc, r, n, fc, 1, VM_COMPACT_BACKGROUND, 1); }
+
+/* one content per page and no writes: nothing merges, so replacement must
+ * match the plain policies */
+static int via_ksm(struct PTE *pt, int tc, int *r, int n, int fc, int lru) {
+    struct vm_ksm_params p;
+    struct vm_ksm_stats st;
+    uint64_t *content = malloc(sizeof(uint64_t) * (size_t)(n > 0 ? n : 1));
+    if (!content) return -1;
+    for (int i = 0; i < n; ++i) content[i] = (uint64_t)r[i];
+    vm_ksm_defaults(&p);
+    p.lru = lru;
+    p.scan_interval = 1;
+    int faults = vm_ksm_run(pt, tc, r, content, n, fc, &p, &st);
+    free(content);
+    return faults;
+}
+
+static int ksm_fifo(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)fp; return via_ksm(pt, tc, r, n, fc, 0); }
+static int ksm_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)fp; return via_ksm(pt, tc, r, n, fc, 1); }
+
+/* a host under pressure swaps guest frames but must not change what the
+ * guest evicts */
+static int via_nested(struct PTE *pt, int tc, int *r, int n, int fc, const char *guest) {
+    struct vm_nested_params p;
+    struct vm_nested_stats st;
+    vm_nested_defaults(&p);
+    return vm_nested_run(vm_policy_find(guest), pt, tc, fc, vm_policy_find("lru"),
+                         fc > 1 ? fc / 2 : 1, r, n, &p, &st);
+}
+
+static int nested_fifo(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)fp; return via_nested(pt, tc, r, n, fc, "fifo"); }
+static int nested_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)fp; return via_nested(pt, tc, r, n, fc, "lru"); }
+
+/* Guest g of an overcommitted host replays the trace rotated by g */
+#define GUESTS 3
+
+static void rotate(int *dst, const int *r, int n, int g) {
+    for (int i = 0; i < n; ++i) dst[i] = r[(i + g) % n];
+}
+
+/* every guest alone on max(fc, 1) frames */
+static int via_guests(int tc, int *r, int n, int fc, const char *guest) {
+    int per = fc > 0 ? fc : 1;
+    struct PTE *pt = malloc(sizeof(struct PTE) * (size_t)tc);
+    int *refs = malloc(sizeof(int) * (size_t)(n > 0 ? n : 1));
+    int *pool = malloc(sizeof(int) * (size_t)per);
+    int faults = -1;
+    if (pt && refs && pool) {
+        faults = 0;
+        for (int g = 0; g < GUESTS && faults >= 0; ++g) {
+            memset(pt, 0, sizeof(struct PTE) * (size_t)tc);
+            for (int f = 0; f < per; ++f) pool[f] = f;
+            rotate(refs, r, n, g);
+            int rc = vm_policy_run(vm_policy_find(guest), pt, tc, refs, n, pool, per);
+            faults = rc < 0 ? -1 : faults + rc;
+        }
+    }
+    free(pt);
+    free(refs);
+    free(pool);
+    return faults;
+}
+
+/* A host with a frame for every guest frame never swaps, and fixed balloons at
+ * an even split leave each guest max(fc, 1) frames of a larger pool: either
+ * way the guests fault as they would alone */
+static int via_balloon(int tc, int *r, int n, int fc, const char *guest,
+                       enum vm_overcommit_mode mode) {
+    int per = fc > 0 ? fc : 1;
+    size_t len = (size_t)(n > 0 ? n : 1);
+    int *copies = malloc(sizeof(int) * len * GUESTS);
+    struct vm_hdr *h = malloc(sizeof(*h));
+    const int *refs[GUESTS];
+    struct vm_latency_costs c;
+    struct vm_balloon_params p;
+    struct vm_balloon_stats st;
+    int faults = -1;
+    if (copies && h) {
+        for (int g = 0; g < GUESTS; ++g) {
+            rotate(copies + len * (size_t)g, r, n, g);
+            refs[g] = copies + len * (size_t)g;
+        }
+        vm_latency_defaults(&c);
+        vm_balloon_defaults(&p);
+        p.mode = mode;
+        p.step = 0;
+        vm_hdr_init(h);
+        faults = vm_balloon_run(vm_policy_find(guest), refs, GUESTS, n, tc,
+                                mode == VM_OVERCOMMIT_SWAP ? per : per + 2,
+                                vm_policy_find("lru"), GUESTS * per, &c, &p, h, &st);
+        if (st.host_faults || st.ballooned) faults = -1;
+    }
+    free(copies);
+    free(h);
+    return faults;
+}
+
+static int guests_fifo(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)pt; (void)fp; return via_guests(tc, r, n, fc, "fifo"); }
+static int guests_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)pt; (void)fp; return via_guests(tc, r, n, fc, "lru"); }
+static int swap_fifo(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)pt; (void)fp; return via_balloon(tc, r, n, fc, "fifo", VM_OVERCOMMIT_SWAP); }
+static int swap_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)pt; (void)fp; return via_balloon(tc, r, n, fc, "lru", VM_OVERCOMMIT_SWAP); }
+static int balloon_fifo(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)pt; (void)fp; return via_balloon(tc, r, n, fc, "fifo", VM_OVERCOMMIT_BALLOON); }
+static int balloon_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) { (void)pt; (void)fp; return via_balloon(tc, r, n, fc, "lru", VM_OVERCOMMIT_BALLOON); }
+
+static int cluster1_lru(struct PTE *pt, int tc, int *r, int n, int *fp, int fc) {
+    return count_page_faults_cluster(pt, tc, r, n, fp, fc, 1, 0, NULL);
+}
+
+struct check {
+    const char *name;
+    count_fn oracle;
+    count_fn engine;
+    int flags;
+};
+
+#define FAULTS_ONLY 1   /* engine has no page table to compare */
+#define IN_RANGE 2      /* engine has no table to check references against */
+
+static const struct check checks[] = {
+    { "fifo/count", oracle_fifo, count_page_faults_fifo, 0 },
+    { "fifo/vtable", oracle_fifo, vt_fifo, 0 },
+    { "fifo/access", oracle_fifo, acc_fifo, 0 },
+    { "fifo/queue", oracle_fifo, queue_fifo, 0 },
+    { "fifo/frames", oracle_fifo, count_page_faults_fifo_frames, 0 },
+    { "fifo/buddy", oracle_fifo, buddy_fifo, 0 },
+    { "fifo/ksm", oracle_fifo, ksm_fifo, 0 },
+    { "fifo/nested", oracle_fifo, nested_fifo, 0 },
+    { "fifo/host-swap", guests_fifo, swap_fifo, FAULTS_ONLY },
+    { "fifo/balloon", guests_fifo, balloon_fifo, FAULTS_ONLY },
+    { "lru/count", oracle_lru, count_page_faults_lru, 0 },
+    { "lru/vtable", oracle_lru, vt_lru, 0 },
+    { "lru/access", oracle_lru, acc_lru, 0 },
+    { "lru/cluster1", oracle_lru, cluster1_lru, 0 },
+    { "lru/stack", oracle_lru, stack_lru, FAULTS_ONLY },
+    { "lru/frames", oracle_lru, count_page_faults_lru_frames, 0 },
+    { "lru/hashed", oracle_lru, hashed_lru, IN_RANGE },
+    { "lru/pagesize", oracle_lru, pagesize_lru, FAULTS_ONLY | IN_RANGE },
+    { "lru/buddy", oracle_lru, buddy_lru, 0 },
+    { "lru/ksm", oracle_lru, ksm_lru, 0 },
+    { "lru/nested", oracle_lru, nested_lru, 0 },
+    { "lru/host-swap", guests_lru, swap_lru, FAULTS_ONLY },
+    { "lru/balloon", guests_lru, balloon_lru, FAULTS_ONLY },
+    { "lfu/count", oracle_lfu, count_page_faults_lfu, 0 },
+    { "lfu/vtable", oracle_lfu, vt_lfu, 0 },
+    { "lfu/access", oracle_lfu, acc_lfu, 0 },
+    { "lfu/frames", oracle_lfu, count_page_faults_lfu_frames, 0 },
+    { "mru/count", oracle_mru, count_page_faults_mru, 0 },
+    { "mru/vtable", oracle_mru, vt_mru, 0 },
+    /* random has no scanning oracle; the fast path must match the vtable path */
+    { "random/count", vt_random, count_page_faults_random, 0 },
+    { "random/compact", vt_random, compact_random, 0 },
+    { "opt/stack", oracle_opt, stack_opt, FAULTS_ONLY },
+    { "thp/fifo", thp_fifo, thp_fifo_checked, 0 },
+    { "thp/direct", thp_direct, thp_direct_checked, 0 },
+    { "thp/background", thp_background, thp_background_checked, 0 },
+};
+
+#define NCHECKS ((int)(sizeof(checks) / sizeof(checks[0])))
+
+/* ---------------- harness ---------------- */
+
+static unsigned int prng;
+
+static unsigned int next_rand(void) {
+    prng ^= prng << 13;
+    prng ^= prng >> 17;
+    prng ^= prng << 5;
+    return prng;
+}
+
+static void run(count_fn fn, const struct vcase *c, struct outcome *out) {
+    struct PTE page_table[MAX_TABLE];
+    int frame_pool[MAX_TABLE];
+    unsigned int s = c->pool_seed ? c->pool_seed : 1;
+
+    memset(page_table, 0, sizeof(page_table));
+    for (int f = 0; f < c->frames; ++f) frame_pool[f] = f;
+    for (int f = c->frames - 1; f > 0; --f) {
+        s ^= s << 13; s ^= s >> 17; s ^= s << 5;
+        int j = (int)(s % (unsigned int)(f + 1));
+        int tmp = frame_pool[f];
+        frame_pool[f] = frame_pool[j];
+        frame_pool[j] = tmp;
+    }
+    out->faults = fn(page_table, c->table_cnt, c->refs, c->n, frame_pool, c->frames);
+    for (int i = 0; i < MAX_TABLE; ++i) out->valid[i] = i < c->table_cnt && page_table[i].is_valid;
+}
+
+static int mismatch(const struct check *k, const struct vcase *c) {
+    struct outcome a, b;
+    run(k->oracle, c, &a);
+    run(k->engine, c, &b);
+    return a.faults != b.faults ||
+           (!(k->flags & FAULTS_ONLY) && memcmp(a.valid, b.valid, sizeof(a.valid)) != 0);
+}
+
+/* Shrink a failing case in place: drop chunks of references, then frames */
+static void shrink(const struct check *k, struct vcase *c) {
+    int progress = 1;
+    while (progress) {
+        progress = 0;
+        for (int chunk = c->n / 2 > 0 ? c->n / 2 : 1; chunk >= 1 && c->n > 0; chunk /= 2) {
+            for (int start = 0; start + chunk <= c->n;) {
+                struct vcase t = *c;
+                int saved[chunk];
+                memcpy(saved, c->refs + start, sizeof(int) * (size_t)chunk);
+                memmove(c->refs + start, c->refs + start + chunk,
+                        sizeof(int) * (size_t)(c->n - start - chunk));
+                t.n = c->n - chunk;
+                if (mismatch(k, &t)) {
+                    c->n = t.n;
+                    progress = 1;
+                } else {
+                    memmove(c->refs + start + chunk, c->refs + start,
+                            sizeof(int) * (size_t)(c->n - start - chunk));
+                    memcpy(c->refs + start, saved, sizeof(int) * (size_t)chunk);
+                    start += chunk;
+                }
+            }
+        }
+        while (c->frames > 0) {
+            struct vcase t = *c;
+            t.frames--;
+            if (!mismatch(k, &t)) break;
+            c->frames--;
+            progress = 1;
+        }
+    }
+}
+
+static void report(const struct check *k, const struct vcase *c) {
+    struct outcome a, b;
+    run(k->oracle, c, &a);
+    run(k->engine, c, &b);
+    printf("MISMATCH %s (%s kernels): table=%d frames=%d pool_seed=%u oracle=%d engine=%d\n",
+           k->name, vm_simd_variant(), c->table_cnt, c->frames, c->pool_seed, a.faults, b.faults);
+    printf("  refs:");
+    for (int i = 0; i < c->n; ++i) printf(" %d", c->refs[i]);
+    printf("\n");
+}
+
+static void make_case(struct vcase *c, int max_refs) {
+    c->table_cnt = 1 + (int)(next_rand() % MAX_TABLE);
+    c->frames = (int)(next_rand() % (unsigned int)(c->table_cnt + 5));
+    if (c->frames > MAX_TABLE) c->frames = MAX_TABLE;
+    c->n = (int)(next_rand() % (unsigned int)(max_refs + 1));
+    c->pool_seed = next_rand();
+    int hot = 1 + c->table_cnt / 8;
+    switch (next_rand() % 3) {
+    case 0:  /* uniform */
+        for (int i = 0; i < c->n; ++i) c->refs[i] = (int)(next_rand() % (unsigned int)c->table_cnt);
+        break;
+    case 1: { /* loop over a prefix of the table */
+        int period = 1 + (int)(next_rand() % (unsigned int)c->table_cnt);
+        for (int i = 0; i < c->n; ++i) c->refs[i] = i % period;
+        break;
+    }
+    default: /* hot set with occasional cold pages */
+        for (int i = 0; i < c->n; ++i)
+            c->refs[i] = next_rand() % 4 ? (int)(next_rand() % (unsigned int)hot)
+                                          : (int)(next_rand() % (unsigned int)c->table_cnt);
+        break;
+    }
+    /* one case in eight references pages on either side of the table */
+    c->out_of_range = next_rand() % 8 == 0;
+    for (int i = 0; c->out_of_range && i < c->n; ++i)
+        if (next_rand() % 16 == 0)
+            c->refs[i] = next_rand() % 2 ? -1 - (int)(next_rand() % 4)
+                                         : c->table_cnt + (int)(next_rand() % 4);
+}
+
+/* ---------------- fixed traces ----------------
+ * Small traces whose statistics are worked out by hand, for what the
+ * oracles above cannot see. Each returns the number of wrong values.
+ */
+
+static int expect(const char *name, const char *what, long long got, long long want) {
+    if (got == want) return 0;
+    printf("MISMATCH %s: %s = %lld, expected %lld\n", name, what, got, want);
+    return 1;
+}
+
+/* Two LRU guests of 4 frames on 4 host frames, limits 2 + 2, one frame moved
+ * every 4 rounds. Guest 1 cycles 4 pages and faults every time; guest 0
+ * faults twice on its pair, so after round 4 its balloon inflates by one and
+ * evicts page 0. On one frame the pair then faults 4 more times, while guest
+ * 1's cycle still misses on 3. The next adjustment sees a tie and moves
+ * nothing. */
+static int fixed_balloon(struct vm_hdr *h) {
+    static const int g0[] = { 0, 1, 0, 1, 0, 1, 0, 1 };
+    static const int g1[] = { 0, 1, 2, 3, 0, 1, 2, 3 };
+    const int *refs[] = { g0, g1 };
+    const struct vm_policy_ops *lru = vm_policy_find("lru");
+    struct vm_latency_costs c;
+    struct vm_balloon_params p = { VM_OVERCOMMIT_BALLOON, 4, 1, 1 };
+    struct vm_balloon_stats st;
+    vm_latency_defaults(&c);
+    vm_hdr_init(h);
+    int bad = expect("balloon/inflate", "guest faults",
+                     vm_balloon_run(lru, refs, 2, 8, 4, 4, lru, 4, &c, &p, h, &st), 14);
+    bad += expect("balloon/inflate", "ballooned", st.ballooned, 1);
+    bad += expect("balloon/inflate", "adjustments", st.adjustments, 1);
+    bad += expect("balloon/inflate", "host faults", st.host_faults, 0);
+    return bad;
+}
+
+/* One LRU guest of 2 frames on a 1-frame LRU host. Page 1 pushes page 0's
+ * frame out to host swap; page 2 makes the guest evict page 0, which swaps
+ * that frame back in only to write it out (double paging). The hit on page 1
+ * then swaps its frame in: two host faults, one of them double paging. */
+static int fixed_double_paging(struct vm_hdr *h) {
+    static const int g0[] = { 0, 1, 2, 1 };
+    const int *refs[] = { g0 };
+    const struct vm_policy_ops *lru = vm_policy_find("lru");
+    struct vm_latency_costs c;
+    struct vm_balloon_params p = { VM_OVERCOMMIT_SWAP, 0, 0, 1 };
+    struct vm_balloon_stats st;
+    vm_latency_defaults(&c);
+    vm_hdr_init(h);
+    int bad = expect("balloon/double-paging", "guest faults",
+                     vm_balloon_run(lru, refs, 1, 4, 3, 2, lru, 1, &c, &p, h, &st), 3);
+    bad += expect("balloon/double-paging", "host faults", st.host_faults, 2);
+    bad += expect("balloon/double-paging", "double paging", st.double_paging, 1);
+    bad += expect("balloon/double-paging", "ballooned", st.ballooned, 0);
+    return bad;
+}
+
+/* Pages 0 and 1 both hold 7 on 4 frames, scanned every reference. The scan
+ * before the third reference merges page 1 onto page 0's frame, so three
+ * pages sit on two frames. Writing 8 to page 1 then takes a COW fault that
+ * gives it a frame of its own again. */
+static int fixed_ksm_cow(void) {
+    static const int refs[] = { 0, 1, 2, 1 };
+    static const uint64_t content[] = { 7, 7, 9, 8 };
+    struct vm_ksm_params p = { 1, 1, 4 };
+    struct vm_ksm_stats st;
+    struct PTE pt[3];
+    memset(pt, 0, sizeof(pt));
+    int bad = expect("ksm/merge", "faults", vm_ksm_run(pt, 3, refs, content, 3, 4, &p, &st), 3);
+    bad += expect("ksm/merge", "merged", st.merged, 1);
+    bad += expect("ksm/merge", "saved", st.saved, 1);
+    bad += expect("ksm/merge", "shared frame", pt[0].frame_number == pt[1].frame_number, 1);
+    memset(pt, 0, sizeof(pt));
+    bad += expect("ksm/cow", "faults", vm_ksm_run(pt, 3, refs, content, 4, 4, &p, &st), 3);
+    bad += expect("ksm/cow", "cow faults", st.cow_faults, 1);
+    bad += expect("ksm/cow", "saved", st.saved, 0);
+    bad += expect("ksm/cow", "split", pt[0].is_valid && pt[1].is_valid &&
+                                     pt[0].frame_number != pt[1].frame_number, 1);
+    return bad;
+}
+
+/* FIFO over 2 frames: pages 0 and 1 merge onto frame 0, the oldest, so page
+ * 3's fault evicts it and unmaps both */
+static int fixed_ksm_evict(void) {
+    static const int refs[] = { 0, 1, 2, 3 };
+    static const uint64_t content[] = { 5, 5, 6, 7 };
+    struct vm_ksm_params p = { 0, 1, 2 };
+    struct vm_ksm_stats st;
+    struct PTE pt[4];
+    memset(pt, 0, sizeof(pt));
+    int bad = expect("ksm/evict", "faults", vm_ksm_run(pt, 4, refs, content, 4, 2, &p, &st), 4);
+    bad += expect("ksm/evict", "merged", st.merged, 1);
+    bad += expect("ksm/evict", "page 0 valid", pt[0].is_valid, 0);
+    bad += expect("ksm/evict", "page 1 valid", pt[1].is_valid, 0);
+    bad += expect("ksm/evict", "page 2 valid", pt[2].is_valid, 1);
+    bad += expect("ksm/evict", "page 3 valid", pt[3].is_valid, 1);
+    bad += expect("ksm/evict", "saved", st.saved, 0);
+    return bad;
+}
+
+static int fixed_traces(void) {
+    struct vm_hdr *h = malloc(sizeof(*h));
+    if (!h) return 1;
+    int bad = fixed_balloon(h) + fixed_double_paging(h) + fixed_ksm_cow() + fixed_ksm_evict();
+    free(h);
+    return bad;
+}
+
+int main(int argc, char **argv) {
+    int iterations = 2000;
+    int max_refs = 300;
+    unsigned int seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:m:")) != -1) {
+        switch (opt) {
+        case 'n': iterations = atoi(optarg); break;
+        case 's': seed = (unsigned int)strtoul(optarg, NULL, 10); break;
+        case 'm': max_refs = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: vmverify [-n ITERATIONS] [-s SEED] [-m MAX_REFS]\n");
+            return 2;
+        }
+    }
+    if (max_refs < 0) max_refs = 0;
+    prng = seed ? seed : 1;
+
+    int *refs = malloc(sizeof(int) * (size_t)(max_refs + 1));
+    if (!refs) return 2;
+    int failures = fixed_traces();
+    for (int it = 0; it < iterations; ++it) {
+        struct vcase c;
+        c.refs = refs;
+        make_case(&c, max_refs);
+        for (int k = 0; k < NCHECKS; ++k) {
+            if ((c.out_of_range && (checks[k].flags & IN_RANGE)) || !mismatch(&checks[k], &c))
+                continue;
+            struct vcase small = c;
+            small.refs = malloc(sizeof(int) * (size_t)(c.n > 0 ? c.n : 1));
+            if (!small.refs) return 2;
+            memcpy(small.refs, c.refs, sizeof(int) * (size_t)c.n);
+            shrink(&checks[k], &small);
+            report(&checks[k], &small);
+            free(small.refs);
+            failures++;
+        }
+    }
+    free(refs);
+    printf("vmverify: %d cases x %d engines, %s kernels: %s\n", iterations, NCHECKS,
+           vm_simd_variant(), failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
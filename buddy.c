@@ -0,0 +1,115 @@
+/*
+ * buddy.c
+ *
+ * Free lists are intrusive: next/prev are indexed by the first frame of a
+ * free block, so the allocator needs no memory beyond a few per-frame arrays.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "buddy.h"
+
+static void list_add(struct vm_buddy *b, int frame, int order) {
+    b->prev[frame] = -1;
+    b->next[frame] = b->head[order];
+    if (b->head[order] >= 0) b->prev[b->head[order]] = frame;
+    b->head[order] = frame;
+    b->free_order[frame] = (signed char)order;
+    b->nfree[order]++;
+}
+
+static void list_del(struct vm_buddy *b, int frame, int order) {
+    if (b->prev[frame] >= 0) b->next[b->prev[frame]] = b->next[frame];
+    else b->head[order] = b->next[frame];
+    if (b->next[frame] >= 0) b->prev[b->next[frame]] = b->prev[frame];
+    b->free_order[frame] = -1;
+    b->nfree[order]--;
+}
+
+int vm_buddy_init(struct vm_buddy *b, int nframes, int max_order) {
+    memset(b, 0, sizeof(*b));
+    if (max_order < 0 || max_order > VM_BUDDY_MAX_ORDER || nframes < 0) return -1;
+    size_t n = (size_t)(nframes > 0 ? nframes : 1);
+    b->next = malloc(sizeof(int) * n);
+    b->prev = malloc(sizeof(int) * n);
+    b->free_order = malloc(n);
+    b->busy = calloc(n, 1);
+    if (!b->next || !b->prev || !b->free_order || !b->busy) {
+        vm_buddy_free_all(b);
+        return -1;
+    }
+    b->nframes = nframes;
+    b->max_order = max_order;
+    memset(b->free_order, -1, n);
+    for (int o = 0; o <= VM_BUDDY_MAX_ORDER; ++o) b->head[o] = -1;
+    for (int f = 0; f < nframes;) {
+        int o = max_order;
+        while (o > 0 && ((f & ((1 << o) - 1)) || f + (1 << o) > nframes)) o--;
+        list_add(b, f, o);
+        f += 1 << o;
+    }
+    b->free_frames = nframes;
+    return 0;
+}
+
+void vm_buddy_free_all(struct vm_buddy *b) {
+    free(b->next);
+    free(b->prev);
+    free(b->free_order);
+    free(b->busy);
+    memset(b, 0, sizeof(*b));
+}
+
+int vm_buddy_alloc(struct vm_buddy *b, int order) {
+    if (order < 0 || order > b->max_order) return -1;
+    int o = order;
+    while (o <= b->max_order && b->head[o] < 0) o++;
+    if (o > b->max_order) return -1;
+    int frame = b->head[o];
+    list_del(b, frame, o);
+    while (o > order) {
+        o--;
+        list_add(b, frame + (1 << o), o);
+    }
+    memset(b->busy + frame, 1, (size_t)1 << order);
+    b->free_frames -= 1 << order;
+    return frame;
+}
+
+void vm_buddy_release(struct vm_buddy *b, int frame, int order) {
+    memset(b->busy + frame, 0, (size_t)1 << order);
+    b->free_frames += 1 << order;
+    while (order < b->max_order) {
+        int buddy = frame ^ (1 << order);
+        if (buddy + (1 << order) > b->nframes || b->free_order[buddy] != order) break;
+        list_del(b, buddy, order);
+        if (buddy < frame) frame = buddy;
+        order++;
+    }
+    list_add(b, frame, order);
+}
+
+int vm_buddy_largest(const struct vm_buddy *b) {
+    for (int o = b->max_order; o >= 0; --o)
+        if (b->nfree[o]) return o;
+    return -1;
+}
+
+double vm_buddy_unusable(const struct vm_buddy *b, int order) {
+    if (!b->free_frames) return 0.0;
+    long usable = 0;
+    for (int o = order; o <= b->max_order; ++o) usable += (long)b->nfree[o] << o;
+    return (double)(b->free_frames - usable) / b->free_frames;
+}
+
+int vm_buddy_compact_cost(const struct vm_buddy *b, int order) {
+    int size = 1 << order, best = -1;
+    for (int start = 0; start + size <= b->nframes; start += size) {
+        int used = 0;
+        for (int f = start; f < start + size; ++f) used += b->busy[f];
+        if (best < 0 || used < best) best = used;
+        if (!best) break;
+    }
+    return best;
+}
@@ -0,0 +1,50 @@
+/*
+ * buddy.h
+ *
+ * Binary buddy frame allocator: frames are handed out in aligned blocks of
+ * 2^order, freed blocks merge with their buddy, and per-order free lists make
+ * external fragmentation visible (free memory that cannot satisfy a large
+ * order). This replaces the flat frame_pool where block sizes matter.
+ */
+
+#ifndef BUDDY_H
+#define BUDDY_H
+
+#define VM_BUDDY_MAX_ORDER 10
+
+struct vm_buddy {
+    int nframes;
+    int max_order;
+    int free_frames;
+    int head[VM_BUDDY_MAX_ORDER + 1];   /* first free block per order, -1 if none */
+    int nfree[VM_BUDDY_MAX_ORDER + 1];  /* free blocks per order */
+    int *next, *prev;                   /* free list links, by block head */
+    signed char *free_order;            /* order of a free block starting here, else -1 */
+    unsigned char *busy;                /* per frame */
+};
+
+/* All nframes free, carved into the largest aligned blocks up to max_order.
+ * Returns 0, or -1 if out of memory or max_order is out of range. */
+int vm_buddy_init(struct vm_buddy *b, int nframes, int max_order);
+void vm_buddy_free_all(struct vm_buddy *b);
+
+/* First frame of a free 2^order block, split from the smallest fitting one;
+ * -1 if none is free */
+int vm_buddy_alloc(struct vm_buddy *b, int order);
+
+/* Return a block, or any aligned part of one (a huge block can go back a
+ * frame at a time), merging it with free buddies */
+void vm_buddy_release(struct vm_buddy *b, int frame, int order);
+
+/* Largest order with a free block, -1 if nothing is free */
+int vm_buddy_largest(const struct vm_buddy *b);
+
+/* Unusable free space index for order: the fraction of free frames that sit
+ * in blocks smaller than 2^order (0 if nothing is free) */
+double vm_buddy_unusable(const struct vm_buddy *b, int order);
+
+/* Fewest allocated frames in any aligned 2^order block, i.e. the pages
+ * compaction would have to migrate to free one; -1 if no block fits */
+int vm_buddy_compact_cost(const struct vm_buddy *b, int order);
+
+#endif /* BUDDY_H */
@@ -0,0 +1,83 @@
+/*
+ * cgroup.c
+ *
+ * Follows mm/memcontrol.c in outline:
+ *
+ *   - a fault that would take the group past memory.max first evicts
+ *     synchronously until it fits (the faulting task stalls for it);
+ *   - every charge_batch faults, a group above memory.high reclaims up to
+ *     reclaim_batch pages on the way back to "user space";
+ *   - if it is still above memory.high after that, it is throttled by
+ *     64 s * (overage / high)^2, capped at 2 s and skipped below 10 ms.
+ */
+
+#include <string.h>
+
+#include "cgroup.h"
+
+#define MAX_PENALTY_US 2e6
+#define MIN_PENALTY_US 1e4
+
+void vm_cgroup_defaults(struct vm_cgroup_limits *lim) {
+    lim->high = 0;
+    lim->max = 0;
+    lim->charge_batch = 64;
+    lim->reclaim_batch = 64;
+    lim->reclaim_us = 2.0;
+}
+
+static double high_penalty_us(int usage, int high) {
+    if (usage <= high) return 0.0;
+    double ratio = (double)(usage - high) / high;
+    double us = 64e6 * ratio * ratio;
+    if (us > MAX_PENALTY_US) us = MAX_PENALTY_US;
+    return us < MIN_PENALTY_US ? 0.0 : us;
+}
+
+int vm_cgroup_run(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                  const int *refs, int reference_cnt, const int *frame_pool, int frame_cnt,
+                  const struct vm_cgroup_limits *lim, struct vm_cgroup_stats *st) {
+    memset(st, 0, sizeof(*st));
+    if (table_cnt <= 0) return 0;
+    struct vm_engine e;
+    if (vm_engine_init(&e, ops, page_table, table_cnt, frame_pool, frame_cnt) < 0) return -1;
+
+    int charged = 0;
+    for (int i = 0; i < reference_cnt; ++i) {
+        int page = refs[i];
+        int timestamp = i + 1;
+        int in_table = page >= 0 && page < table_cnt;
+
+        if (lim->max > 0 && in_table && !page_table[page].is_valid && e.resident >= lim->max) {
+            st->max_events++;
+            while (e.resident >= lim->max) {
+                if (vm_engine_evict(&e, timestamp) < 0) goto fail;
+                st->max_reclaimed++;
+                st->stall_us += lim->reclaim_us;
+            }
+        }
+
+        int r = vm_engine_access(&e, page, timestamp);
+        if (r < 0) goto fail;
+        st->faults += r;
+        if (r && in_table) charged++;
+        if (e.resident > st->peak) st->peak = e.resident;
+
+        if (lim->high > 0 && charged >= lim->charge_batch && e.resident > lim->high) {
+            charged = 0;
+            st->high_events++;
+            for (int n = 0; n < lim->reclaim_batch && e.resident > lim->high; ++n) {
+                if (vm_engine_evict(&e, timestamp) < 0) break;
+                st->high_reclaimed++;
+                st->throttle_us += lim->reclaim_us;
+            }
+            st->throttle_us += high_penalty_us(e.resident, lim->high);
+        }
+    }
+    vm_engine_destroy(&e);
+    return st->faults;
+
+fail:
+    vm_engine_destroy(&e);
+    return -1;
+}
@@ -0,0 +1,40 @@
+/*
+ * cgroup.h
+ *
+ * memory.high / memory.max model layered on vm_engine. The engine's frame
+ * pool is the machine's memory; the limits cap how much of it the traced
+ * process may hold, and reclaim goes through the policy's choose_victim.
+ */
+
+#ifndef CGROUP_H
+#define CGROUP_H
+
+#include "vm_engine.h"
+
+struct vm_cgroup_limits {
+    int high;               /* soft limit in pages, 0 for none */
+    int max;                /* hard limit in pages, 0 for none */
+    int charge_batch;       /* faults between memory.high checks (MEMCG_CHARGE_BATCH) */
+    int reclaim_batch;      /* most pages reclaimed per memory.high breach */
+    double reclaim_us;      /* cost of reclaiming one page */
+};
+
+struct vm_cgroup_stats {
+    int faults;
+    int peak;               /* most pages held at once */
+    long long high_events;  /* memory.high breaches */
+    long long high_reclaimed;
+    long long max_events;   /* faults that hit memory.max */
+    long long max_reclaimed;
+    double throttle_us;     /* memory.high reclaim plus over-high penalty */
+    double stall_us;        /* synchronous memory.max reclaim */
+};
+
+void vm_cgroup_defaults(struct vm_cgroup_limits *lim);
+
+/* Replay refs like vm_policy_run under lim. Returns the fault count or -1. */
+int vm_cgroup_run(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                  const int *refs, int reference_cnt, const int *frame_pool, int frame_cnt,
+                  const struct vm_cgroup_limits *lim, struct vm_cgroup_stats *st);
+
+#endif /* CGROUP_H */
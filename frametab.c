@@ -0,0 +1,160 @@
+/*
+ * frametab.c
+ *
+ * Walking frames in frame_number order makes "smallest frame_number" the
+ * natural last tie-break, matching choose_*_victim_pte. Free frames are taken
+ * from the front of frame_pool as the counting functions do; the pool array
+ * itself is consumed through an index instead of being shifted.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "frametab.h"
+
+int vm_frame_table_init(struct vm_frame_table *ft, const struct PTE *page_table, int table_cnt,
+                        const int *frame_pool, int frame_cnt) {
+    int max = -1;
+    ft->frames = NULL;
+    ft->frame_cnt = 0;
+    for (int i = 0; i < frame_cnt; ++i) {
+        if (frame_pool[i] < 0) return -1;
+        if (frame_pool[i] > max) max = frame_pool[i];
+    }
+    for (int p = 0; p < table_cnt; ++p) {
+        if (!page_table[p].is_valid) continue;
+        if (page_table[p].frame_number < 0) return -1;
+        if (page_table[p].frame_number > max) max = page_table[p].frame_number;
+    }
+    ft->frame_cnt = max + 1;
+    ft->frames = malloc(sizeof(struct vm_frame) * (size_t)(ft->frame_cnt > 0 ? ft->frame_cnt : 1));
+    if (!ft->frames) return -1;
+    for (int f = 0; f < ft->frame_cnt; ++f) ft->frames[f].page = -1;
+    for (int p = 0; p < table_cnt; ++p) {
+        if (!page_table[p].is_valid) continue;
+        struct vm_frame *fr = &ft->frames[page_table[p].frame_number];
+        fr->page = p;
+        fr->arrival_timestamp = page_table[p].arrival_timestamp;
+        fr->last_access_timestamp = page_table[p].last_access_timestamp;
+        fr->reference_count = page_table[p].reference_count;
+    }
+    return 0;
+}
+
+void vm_frame_table_free(struct vm_frame_table *ft) {
+    free(ft->frames);
+    ft->frames = NULL;
+}
+
+void vm_frame_table_sync(const struct vm_frame_table *ft, struct PTE *page_table) {
+    for (int f = 0; f < ft->frame_cnt; ++f) {
+        const struct vm_frame *fr = &ft->frames[f];
+        if (fr->page < 0) continue;
+        struct PTE *p = &page_table[fr->page];
+        p->arrival_timestamp = fr->arrival_timestamp;
+        p->last_access_timestamp = fr->last_access_timestamp;
+        p->reference_count = fr->reference_count;
+    }
+}
+
+enum frame_key { KEY_ARRIVAL, KEY_LAST_ACCESS, KEY_REFCOUNT };
+
+/* Occupied frame with the smallest key, then smallest arrival, then smallest
+ * frame number; -1 if none is occupied */
+static int choose_victim_frame(const struct vm_frame_table *ft, enum frame_key key) {
+    int victim = -1;
+    int min_key = 0, min_arr = 0;
+    for (int f = 0; f < ft->frame_cnt; ++f) {
+        const struct vm_frame *fr = &ft->frames[f];
+        if (fr->page < 0) continue;
+        int k = key == KEY_ARRIVAL ? fr->arrival_timestamp
+              : key == KEY_LAST_ACCESS ? fr->last_access_timestamp
+              : fr->reference_count;
+        if (victim < 0 || k < min_key || (k == min_key && fr->arrival_timestamp < min_arr)) {
+            victim = f;
+            min_key = k;
+            min_arr = fr->arrival_timestamp;
+        }
+    }
+    return victim;
+}
+
+static int count_frames(struct PTE *page_table, int table_cnt, int *refs, int reference_cnt,
+                        int *frame_pool, int frame_cnt, enum frame_key key, int victim_fill) {
+    if (table_cnt <= 0) return 0;
+    struct vm_frame_table ft;
+    if (vm_frame_table_init(&ft, page_table, table_cnt, frame_pool, frame_cnt) < 0) {
+        vm_frame_table_free(&ft);
+        return -1;
+    }
+    int next_free = 0;
+    int faults = 0;
+
+    for (int i = 0; i < reference_cnt; ++i) {
+        int page = refs[i];
+        int timestamp = i + 1; /* start at 1 per spec */
+
+        if (page < 0 || page >= table_cnt) {
+            faults++;
+            continue;
+        }
+        struct PTE *p = &page_table[page];
+        if (p->is_valid) {
+            struct vm_frame *fr = &ft.frames[p->frame_number];
+            fr->last_access_timestamp = timestamp;
+            fr->reference_count += 1;
+            continue;
+        }
+
+        faults++;
+        int fn;
+        if (next_free < frame_cnt) {
+            fn = frame_pool[next_free++];
+        } else {
+            fn = choose_victim_frame(&ft, key);
+            if (fn < 0) continue;
+            struct PTE *v = &page_table[ft.frames[fn].page];
+            v->is_valid = 0;
+            v->frame_number = -1;
+            v->arrival_timestamp = victim_fill;
+            v->last_access_timestamp = victim_fill;
+            v->reference_count = victim_fill;
+        }
+        struct vm_frame *fr = &ft.frames[fn];
+        fr->page = page;
+        fr->arrival_timestamp = timestamp;
+        fr->last_access_timestamp = timestamp;
+        fr->reference_count = 1;
+        p->is_valid = 1;
+        p->frame_number = fn;
+    }
+
+    /* leave the pool as the shifting pops would have */
+    if (next_free > 0)
+        memmove(frame_pool, frame_pool + next_free, sizeof(int) * (size_t)(frame_cnt - next_free));
+    vm_frame_table_sync(&ft, page_table);
+    vm_frame_table_free(&ft);
+    return faults;
+}
+
+/* FIFO counting zeroes victims to -1, LRU and LFU counting to 0 */
+int count_page_faults_fifo_frames(struct PTE *page_table, int table_cnt,
+                                  int refrence_string[REFERENCEMAX], int reference_cnt,
+                                  int frame_pool[POOLMAX], int frame_cnt) {
+    return count_frames(page_table, table_cnt, refrence_string, reference_cnt, frame_pool,
+                        frame_cnt, KEY_ARRIVAL, -1);
+}
+
+int count_page_faults_lru_frames(struct PTE *page_table, int table_cnt,
+                                 int refrence_string[REFERENCEMAX], int reference_cnt,
+                                 int frame_pool[POOLMAX], int frame_cnt) {
+    return count_frames(page_table, table_cnt, refrence_string, reference_cnt, frame_pool,
+                        frame_cnt, KEY_LAST_ACCESS, 0);
+}
+
+int count_page_faults_lfu_frames(struct PTE *page_table, int table_cnt,
+                                 int refrence_string[REFERENCEMAX], int reference_cnt,
+                                 int frame_pool[POOLMAX], int frame_cnt) {
+    return count_frames(page_table, table_cnt, refrence_string, reference_cnt, frame_pool,
+                        frame_cnt, KEY_REFCOUNT, 0);
+}
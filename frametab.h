@@ -0,0 +1,53 @@
+/*
+ * frametab.h
+ *
+ * Inverted page table: one entry per physical frame, indexed by frame_number,
+ * holding the owning page and the replacement metadata. Victim selection then
+ * walks the frames instead of the whole page table, so its cost and the
+ * policy metadata scale with memory size rather than address-space size.
+ *
+ * The count functions below take the same arguments as count_page_faults_*
+ * and leave the page table exactly as those do; the PTE only carries the
+ * mapping during the run and gets its metadata back at the end.
+ */
+
+#ifndef FRAMETAB_H
+#define FRAMETAB_H
+
+#include "oslabs.h"
+
+struct vm_frame {
+    int page;                   /* owner, -1 if the frame is free */
+    int arrival_timestamp;
+    int last_access_timestamp;
+    int reference_count;
+};
+
+struct vm_frame_table {
+    struct vm_frame *frames;    /* indexed by frame_number */
+    int frame_cnt;              /* largest frame number + 1 */
+};
+
+/* Size the table for frame_pool and the frames of pages already valid, and
+ * move those pages' metadata in. Returns 0, or -1 if out of memory or a frame
+ * number is negative. */
+int vm_frame_table_init(struct vm_frame_table *ft, const struct PTE *page_table, int table_cnt,
+                        const int *frame_pool, int frame_cnt);
+void vm_frame_table_free(struct vm_frame_table *ft);
+
+/* Copy the frames' metadata back into the owners' PTEs */
+void vm_frame_table_sync(const struct vm_frame_table *ft, struct PTE *page_table);
+
+/* Same results as count_page_faults_{fifo,lru,lfu}, out-of-range pages
+ * included; -1 if the table cannot be built */
+int count_page_faults_fifo_frames(struct PTE *page_table, int table_cnt,
+                                  int refrence_string[REFERENCEMAX], int reference_cnt,
+                                  int frame_pool[POOLMAX], int frame_cnt);
+int count_page_faults_lru_frames(struct PTE *page_table, int table_cnt,
+                                 int refrence_string[REFERENCEMAX], int reference_cnt,
+                                 int frame_pool[POOLMAX], int frame_cnt);
+int count_page_faults_lfu_frames(struct PTE *page_table, int table_cnt,
+                                 int refrence_string[REFERENCEMAX], int reference_cnt,
+                                 int frame_pool[POOLMAX], int frame_cnt);
+
+#endif /* FRAMETAB_H */
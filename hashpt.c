@@ -0,0 +1,283 @@
+/*
+ * hashpt.c
+ *
+ * Two candidate buckets per key, taken from the two halves of one 64-bit
+ * mix. Inserts displace a resident key to its other bucket at most
+ * VM_HPT_MAX_KICKS times; if the chain does not end, the table grows. The
+ * only blocking path is a failed insert while a resize is already running,
+ * which rehashes everything into a larger table at once (counted in
+ * stats.rebuilds; it needs a chain longer than the kick limit in a table at
+ * most half full).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashpt.h"
+
+#define EMPTY UINT64_MAX
+
+static uint64_t make_key(int pid, int vpn) {
+    return (uint64_t)(uint32_t)pid << 32 | (uint32_t)vpn;
+}
+
+static uint64_t mix(uint64_t k) {
+    k ^= k >> 30;
+    k *= 0xbf58476d1ce4e5b9ULL;
+    k ^= k >> 27;
+    k *= 0x94d049bb133111ebULL;
+    return k ^ (k >> 31);
+}
+
+static void buckets_of(const struct vm_hpt_table *t, uint64_t key, unsigned int *b1,
+                       unsigned int *b2) {
+    uint64_t m = mix(key);
+    unsigned int mask = t->nbuckets - 1;
+    *b1 = (unsigned int)m & mask;
+    *b2 = (unsigned int)(m >> 32) & mask;
+    if (*b2 == *b1) *b2 = *b1 ^ 1u;
+    *b2 &= mask;
+}
+
+static int table_alloc(struct vm_hpt_table *t, unsigned int nbuckets) {
+    size_t slots = (size_t)nbuckets * VM_BUCKET_SLOTS;
+    t->keys = aligned_alloc(64, sizeof(uint64_t) * slots);
+    t->vals = malloc(sizeof(int) * slots);
+    t->nbuckets = nbuckets;
+    t->count = 0;
+    if (!t->keys || !t->vals) {
+        free(t->keys);
+        free(t->vals);
+        memset(t, 0, sizeof(*t));
+        return -1;
+    }
+    memset(t->keys, 0xff, sizeof(uint64_t) * slots);
+    return 0;
+}
+
+static void table_free(struct vm_hpt_table *t) {
+    free(t->keys);
+    free(t->vals);
+    memset(t, 0, sizeof(*t));
+}
+
+/* Slot index holding key in t, -1 if absent */
+static long find(const struct vm_hpt_table *t, uint64_t key, struct vm_hpt_stats *st) {
+    if (!t->nbuckets) return -1;
+    unsigned int b[2];
+    buckets_of(t, key, &b[0], &b[1]);
+    for (int i = 0; i < 2 && (i == 0 || b[1] != b[0]); ++i) {
+        st->probes++;
+        long base = (long)b[i] * VM_BUCKET_SLOTS;
+        int s = vm_bucket_find(t->keys + base, key);
+        if (s >= 0) return base + s;
+    }
+    return -1;
+}
+
+/* Cuckoo insert of a key known to be absent. On failure *key and *val hold
+ * the entry left without a slot, which may not be the one passed in. */
+static int place(struct vm_hpt_table *t, uint64_t *key, int *val, struct vm_hpt_stats *st) {
+    for (int kick = 0; kick <= VM_HPT_MAX_KICKS; ++kick) {
+        unsigned int b[2];
+        buckets_of(t, *key, &b[0], &b[1]);
+        for (int i = 0; i < 2; ++i) {
+            long base = (long)b[i] * VM_BUCKET_SLOTS;
+            int s = vm_bucket_find(t->keys + base, EMPTY);
+            if (s >= 0) {
+                t->keys[base + s] = *key;
+                t->vals[base + s] = *val;
+                t->count++;
+                return 0;
+            }
+        }
+        if (kick == VM_HPT_MAX_KICKS) break;
+        /* alternate buckets and vary the slot so chains do not cycle */
+        long at = (long)b[kick & 1] * VM_BUCKET_SLOTS + (long)((*key ^ (uint64_t)kick) & 7);
+        uint64_t k = t->keys[at];
+        int v = t->vals[at];
+        t->keys[at] = *key;
+        t->vals[at] = *val;
+        *key = k;
+        *val = v;
+        st->kicks++;
+    }
+    return -1;
+}
+
+/* Copy every entry of src into t; -1 if one does not fit */
+static int copy_all(struct vm_hpt_table *t, const struct vm_hpt_table *src,
+                    struct vm_hpt_stats *st) {
+    size_t slots = (size_t)src->nbuckets * VM_BUCKET_SLOTS;
+    for (size_t i = 0; i < slots; ++i) {
+        if (src->keys[i] == EMPTY) continue;
+        uint64_t k = src->keys[i];
+        int v = src->vals[i];
+        if (place(t, &k, &v, st) < 0) return -1;
+    }
+    return 0;
+}
+
+/* Rehash cur, old and (key, val) into one table of at least nbuckets */
+static int rebuild(struct vm_hpt *h, unsigned int nbuckets, uint64_t key, int val) {
+    for (;; nbuckets *= 2) {
+        struct vm_hpt_table t;
+        if (table_alloc(&t, nbuckets) < 0) return -1;
+        uint64_t k = key;
+        int v = val;
+        if (copy_all(&t, &h->cur, &h->stats) == 0 && copy_all(&t, &h->old, &h->stats) == 0 &&
+            place(&t, &k, &v, &h->stats) == 0) {
+            table_free(&h->cur);
+            table_free(&h->old);
+            h->cur = t;
+            h->migrated = 0;
+            h->stats.rebuilds++;
+            return 0;
+        }
+        table_free(&t);
+    }
+}
+
+static int start_resize(struct vm_hpt *h) {
+    struct vm_hpt_table t;
+    if (table_alloc(&t, h->cur.nbuckets * 2) < 0) return -1;
+    h->old = h->cur;
+    h->cur = t;
+    h->migrated = 0;
+    h->stats.resizes++;
+    return 0;
+}
+
+/* Move up to VM_HPT_MIGRATE_STEP old buckets into cur */
+static int migrate_step(struct vm_hpt *h) {
+    for (int n = 0; n < VM_HPT_MIGRATE_STEP && h->old.nbuckets; ++n) {
+        long base = (long)h->migrated * VM_BUCKET_SLOTS;
+        for (int s = 0; s < VM_BUCKET_SLOTS; ++s) {
+            uint64_t k = h->old.keys[base + s];
+            if (k == EMPTY) continue;
+            int v = h->old.vals[base + s];
+            h->old.keys[base + s] = EMPTY;
+            h->old.count--;
+            if (place(&h->cur, &k, &v, &h->stats) < 0)
+                return rebuild(h, h->cur.nbuckets * 2, k, v);
+        }
+        if (++h->migrated == h->old.nbuckets) table_free(&h->old);
+    }
+    return 0;
+}
+
+int vm_hpt_init(struct vm_hpt *h, unsigned int nbuckets) {
+    unsigned int nb = 1;
+    while (nb < nbuckets && nb < (1u << 31)) nb *= 2;
+    memset(h, 0, sizeof(*h));
+    return table_alloc(&h->cur, nb);
+}
+
+void vm_hpt_free(struct vm_hpt *h) {
+    table_free(&h->cur);
+    table_free(&h->old);
+}
+
+int vm_hpt_lookup(struct vm_hpt *h, int pid, int vpn) {
+    uint64_t key = make_key(pid, vpn);
+    h->stats.lookups++;
+    long at = find(&h->cur, key, &h->stats);
+    if (at >= 0) return h->cur.vals[at];
+    at = find(&h->old, key, &h->stats);
+    return at >= 0 ? h->old.vals[at] : -1;
+}
+
+int vm_hpt_insert(struct vm_hpt *h, int pid, int vpn, int value) {
+    uint64_t key = make_key(pid, vpn);
+    h->stats.inserts++;
+    if (migrate_step(h) < 0) return -1;
+    long at = find(&h->cur, key, &h->stats);
+    if (at >= 0) {
+        h->cur.vals[at] = value;
+        return 0;
+    }
+    at = find(&h->old, key, &h->stats);
+    if (at >= 0) {
+        h->old.vals[at] = value;
+        return 0;
+    }
+    if (!h->old.nbuckets &&
+        h->cur.count + 1 > VM_HPT_MAX_LOAD * h->cur.nbuckets * VM_BUCKET_SLOTS &&
+        start_resize(h) < 0)
+        return -1;
+
+    int val = value;
+    if (place(&h->cur, &key, &val, &h->stats) < 0) {
+        if (h->old.nbuckets || start_resize(h) < 0 || place(&h->cur, &key, &val, &h->stats) < 0)
+            if (rebuild(h, h->cur.nbuckets * 2, key, val) < 0) return -1;
+    }
+    double load = (double)(h->cur.count + h->old.count) /
+                  ((double)h->cur.nbuckets * VM_BUCKET_SLOTS);
+    if (load > h->stats.peak_load) h->stats.peak_load = load;
+    return 0;
+}
+
+int vm_hpt_remove(struct vm_hpt *h, int pid, int vpn) {
+    uint64_t key = make_key(pid, vpn);
+    if (migrate_step(h) < 0) return -1;
+    struct vm_hpt_table *t = &h->cur;
+    long at = find(t, key, &h->stats);
+    if (at < 0) {
+        t = &h->old;
+        at = find(t, key, &h->stats);
+    }
+    if (at < 0) return -1;
+    t->keys[at] = EMPTY;
+    t->count--;
+    return 0;
+}
+
+/* ---------------- LRU replay ---------------- */
+
+struct hpt_frame {
+    int pid;    /* -1 if free */
+    int vpn;
+    int last_access_timestamp;
+};
+
+int vm_hpt_lru_run(struct vm_hpt *h, const int *refs, const int *pids, int reference_cnt,
+                   int frames) {
+    struct hpt_frame *ft = malloc(sizeof(struct hpt_frame) * (size_t)(frames > 0 ? frames : 1));
+    if (!ft) return -1;
+    int used = 0, faults = 0;
+
+    for (int i = 0; i < reference_cnt; ++i) {
+        int vpn = refs[i];
+        int pid = pids ? pids[i] : 0;
+        int timestamp = i + 1;
+
+        if (vpn < 0 || pid < 0) {
+            faults++;
+            continue;
+        }
+        int f = vm_hpt_lookup(h, pid, vpn);
+        if (f >= 0) {
+            ft[f].last_access_timestamp = timestamp;
+            continue;
+        }
+        faults++;
+        if (frames <= 0) continue;
+        if (used < frames) {
+            f = used++;
+        } else {
+            f = 0;
+            for (int k = 1; k < frames; ++k)
+                if (ft[k].last_access_timestamp < ft[f].last_access_timestamp) f = k;
+            vm_hpt_remove(h, ft[f].pid, ft[f].vpn);
+        }
+        ft[f].pid = pid;
+        ft[f].vpn = vpn;
+        ft[f].last_access_timestamp = timestamp;
+        if (vm_hpt_insert(h, pid, vpn, f) < 0) {
+            free(ft);
+            return -1;
+        }
+    }
+    free(ft);
+    return faults;
+}
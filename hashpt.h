@@ -0,0 +1,69 @@
+/*
+ * hashpt.h
+ *
+ * Hashed page table (PowerPC/IA-64 style): translations live in a bucketized
+ * cuckoo hash keyed by (pid, vpn), so table size follows the resident set and
+ * not the address space. A lookup reads at most two buckets of eight keys
+ * (four while a resize is in flight), each compared with one vector probe.
+ *
+ * Growing is incremental: past the load limit a table twice the size is
+ * allocated and every later insert or remove moves a few old buckets across.
+ */
+
+#ifndef HASHPT_H
+#define HASHPT_H
+
+#include <stdint.h>
+
+#include "vm_simd.h"
+
+#define VM_HPT_MAX_KICKS 32     /* displacements before an insert gives up and grows */
+#define VM_HPT_MIGRATE_STEP 4   /* old buckets moved per insert/remove during a resize */
+#define VM_HPT_MAX_LOAD 0.85
+
+struct vm_hpt_table {
+    uint64_t *keys;     /* nbuckets * VM_BUCKET_SLOTS, UINT64_MAX = empty */
+    int *vals;
+    unsigned int nbuckets;  /* power of two */
+    int count;
+};
+
+struct vm_hpt_stats {
+    long long lookups;
+    long long probes;       /* buckets compared */
+    long long inserts;
+    long long kicks;
+    long long resizes;
+    long long rebuilds;     /* synchronous rehashes after a failed insert mid-resize */
+    double peak_load;
+};
+
+struct vm_hpt {
+    struct vm_hpt_table cur;
+    struct vm_hpt_table old;    /* nbuckets 0 unless resizing */
+    unsigned int migrated;      /* old buckets already moved */
+    struct vm_hpt_stats stats;
+};
+
+/* nbuckets is rounded up to a power of two; 0 or -1 if out of memory */
+int vm_hpt_init(struct vm_hpt *h, unsigned int nbuckets);
+void vm_hpt_free(struct vm_hpt *h);
+
+/* Value mapped to (pid, vpn), -1 if none */
+int vm_hpt_lookup(struct vm_hpt *h, int pid, int vpn);
+
+/* Map or remap (pid, vpn) to value; 0 or -1 if out of memory */
+int vm_hpt_insert(struct vm_hpt *h, int pid, int vpn, int value);
+
+/* 0 if the mapping was there, -1 otherwise */
+int vm_hpt_remove(struct vm_hpt *h, int pid, int vpn);
+
+/* Replay refs under LRU with frames frames, translating every reference
+ * through h; the frame table is inverted (one owner per frame) so no
+ * per-page array is needed. pids may be NULL for a single address space.
+ * Negative page numbers fault without being loaded. Returns the fault count
+ * or -1 if out of memory. */
+int vm_hpt_lru_run(struct vm_hpt *h, const int *refs, const int *pids, int reference_cnt,
+                   int frames);
+
+#endif /* HASHPT_H */
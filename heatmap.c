@@ -0,0 +1,164 @@
+/*
+ * heatmap.c
+ *
+ * Columnar file layout (host byte order):
+ *
+ *     char     magic[4] = "VMHM"
+ *     uint32_t version = 1
+ *     uint32_t rows               referenced pages only
+ *     uint32_t columns = 7
+ *     columns x { char name[15]; uint8_t width; }    width in bytes: 1, 4 or 8
+ *     column data, one contiguous array per column, in directory order:
+ *         page i32, references i32, faults i32, evictions i32,
+ *         residency i64, last_access i32, class u8 (enum vm_heat_class)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "heatmap.h"
+
+int vm_heatmap_init(struct vm_heatmap *hm, int table_cnt) {
+    hm->table_cnt = table_cnt;
+    hm->end_timestamp = 0;
+    hm->pages = calloc(table_cnt > 0 ? (size_t)table_cnt : 1, sizeof(struct vm_page_stats));
+    return hm->pages ? 0 : -1;
+}
+
+void vm_heatmap_free(struct vm_heatmap *hm) {
+    free(hm->pages);
+    hm->pages = NULL;
+}
+
+static void heatmap_on_access(void *ctx, int page, int timestamp, int fault) {
+    struct vm_heatmap *hm = ctx;
+    if (page < 0 || page >= hm->table_cnt) return;
+    struct vm_page_stats *ps = &hm->pages[page];
+    ps->references++;
+    ps->last_access = timestamp;
+    if (fault) {
+        ps->faults++;
+        ps->resident_since = timestamp;
+    }
+}
+
+static void heatmap_on_evict(void *ctx, int page, int timestamp) {
+    struct vm_heatmap *hm = ctx;
+    struct vm_page_stats *ps = &hm->pages[page];
+    ps->evictions++;
+    if (ps->resident_since) ps->residency += timestamp - ps->resident_since;
+    ps->resident_since = 0;
+}
+
+void vm_heatmap_observer(struct vm_heatmap *hm, struct vm_observer *obs) {
+    obs->ctx = hm;
+    obs->on_access = heatmap_on_access;
+    obs->on_evict = heatmap_on_evict;
+}
+
+void vm_heatmap_finish(struct vm_heatmap *hm, int end_timestamp) {
+    hm->end_timestamp = end_timestamp;
+    for (int i = 0; i < hm->table_cnt; ++i) {
+        struct vm_page_stats *ps = &hm->pages[i];
+        if (ps->resident_since) ps->residency += end_timestamp - ps->resident_since;
+        ps->resident_since = 0;
+    }
+}
+
+int vm_heatmap_collect(struct vm_heatmap *hm, const struct vm_policy_ops *ops,
+                       int *refs, int reference_cnt, int frame_cnt) {
+    struct PTE *page_table = calloc(hm->table_cnt > 0 ? (size_t)hm->table_cnt : 1,
+                                    sizeof(struct PTE));
+    int *frame_pool = malloc(sizeof(int) * (size_t)(frame_cnt > 0 ? frame_cnt : 1));
+    int faults = -1;
+    if (page_table && frame_pool) {
+        struct vm_observer obs;
+        for (int f = 0; f < frame_cnt; ++f) frame_pool[f] = f;
+        vm_heatmap_observer(hm, &obs);
+        faults = vm_policy_run_observed(ops, page_table, hm->table_cnt, refs, reference_cnt,
+                                        frame_pool, frame_cnt, &obs);
+        vm_heatmap_finish(hm, reference_cnt + 1);
+    }
+    free(page_table);
+    free(frame_pool);
+    return faults;
+}
+
+struct vm_heat_thresholds vm_heatmap_thresholds(const struct vm_heatmap *hm,
+                                                struct vm_heat_thresholds th) {
+    if (th.hot_refs < 0) {
+        long long refs = 0;
+        int touched = 0;
+        for (int i = 0; i < hm->table_cnt; ++i) {
+            if (hm->pages[i].references) {
+                refs += hm->pages[i].references;
+                touched++;
+            }
+        }
+        th.hot_refs = touched ? (int)(2 * refs / touched) : 1;
+        if (th.hot_refs <= th.cold_refs) th.hot_refs = th.cold_refs + 1;
+    }
+    return th;
+}
+
+enum vm_heat_class vm_heatmap_classify(const struct vm_page_stats *ps,
+                                       const struct vm_heat_thresholds *th) {
+    if (ps->references == 0) return VM_HEAT_UNTOUCHED;
+    if (ps->references >= th->hot_refs) return VM_HEAT_HOT;
+    if (ps->references <= th->cold_refs) return VM_HEAT_COLD;
+    return VM_HEAT_WARM;
+}
+
+struct column {
+    char name[15];
+    uint8_t width;
+};
+
+static const struct column columns[] = {
+    { "page", 4 }, { "references", 4 }, { "faults", 4 }, { "evictions", 4 },
+    { "residency", 8 }, { "last_access", 4 }, { "class", 1 },
+};
+
+int vm_heatmap_write(const struct vm_heatmap *hm, const char *path,
+                     const struct vm_heat_thresholds *th) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+
+    uint32_t rows = 0;
+    for (int i = 0; i < hm->table_cnt; ++i)
+        if (hm->pages[i].references) rows++;
+    uint32_t header[3] = { 1, rows, (uint32_t)(sizeof(columns) / sizeof(columns[0])) };
+    int ok = fwrite("VMHM", 4, 1, f) == 1 && fwrite(header, sizeof(header), 1, f) == 1 &&
+             fwrite(columns, sizeof(columns), 1, f) == 1;
+
+    /* one pass over the table per column keeps every column contiguous */
+    for (int c = 0; ok && c < (int)header[2]; ++c) {
+        for (int i = 0; ok && i < hm->table_cnt; ++i) {
+            const struct vm_page_stats *ps = &hm->pages[i];
+            if (!ps->references) continue;
+            int32_t v32 = 0;
+            int64_t v64;
+            uint8_t v8;
+            switch (c) {
+            case 0: v32 = i; break;
+            case 1: v32 = ps->references; break;
+            case 2: v32 = ps->faults; break;
+            case 3: v32 = ps->evictions; break;
+            case 4:
+                v64 = ps->residency;
+                ok = fwrite(&v64, sizeof(v64), 1, f) == 1;
+                continue;
+            case 5: v32 = ps->last_access; break;
+            default:
+                v8 = (uint8_t)vm_heatmap_classify(ps, th);
+                ok = fwrite(&v8, sizeof(v8), 1, f) == 1;
+                continue;
+            }
+            ok = fwrite(&v32, sizeof(v32), 1, f) == 1;
+        }
+    }
+    if (fclose(f) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,62 @@
+/*
+ * heatmap.h
+ *
+ * Per-page access summary of one replay, collected through a vm_observer, with
+ * a hot/warm/cold classification and a compact columnar dump.
+ */
+
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include "vm_engine.h"
+
+struct vm_page_stats {
+    int references;
+    int faults;
+    int evictions;
+    long long residency;    /* timestamps spent resident */
+    int last_access;        /* 0 if never referenced */
+    int resident_since;     /* arrival of the current residency, 0 if not resident */
+};
+
+struct vm_heatmap {
+    struct vm_page_stats *pages;
+    int table_cnt;
+    int end_timestamp;      /* set by vm_heatmap_finish */
+};
+
+enum vm_heat_class { VM_HEAT_UNTOUCHED, VM_HEAT_COLD, VM_HEAT_WARM, VM_HEAT_HOT };
+
+/* hot: references >= hot_refs; cold: references <= cold_refs; warm otherwise.
+ * A negative hot_refs means twice the mean over referenced pages. */
+struct vm_heat_thresholds {
+    int hot_refs;
+    int cold_refs;
+};
+
+int vm_heatmap_init(struct vm_heatmap *hm, int table_cnt);
+void vm_heatmap_free(struct vm_heatmap *hm);
+
+/* Fill obs so that a run feeds hm */
+void vm_heatmap_observer(struct vm_heatmap *hm, struct vm_observer *obs);
+
+/* Close residencies still open at end_timestamp (reference count + 1) */
+void vm_heatmap_finish(struct vm_heatmap *hm, int end_timestamp);
+
+/* Replay refs with ops on a fresh table of frame_cnt frames into hm.
+ * Returns the fault count or -1. */
+int vm_heatmap_collect(struct vm_heatmap *hm, const struct vm_policy_ops *ops,
+                       int *refs, int reference_cnt, int frame_cnt);
+
+/* Resolve a negative hot_refs against hm */
+struct vm_heat_thresholds vm_heatmap_thresholds(const struct vm_heatmap *hm,
+                                                struct vm_heat_thresholds th);
+
+enum vm_heat_class vm_heatmap_classify(const struct vm_page_stats *ps,
+                                       const struct vm_heat_thresholds *th);
+
+/* Write referenced pages as a columnar file (layout in heatmap.c); 0 or -1 */
+int vm_heatmap_write(const struct vm_heatmap *hm, const char *path,
+                     const struct vm_heat_thresholds *th);
+
+#endif /* HEATMAP_H */
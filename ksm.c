@@ -0,0 +1,248 @@
+/*
+ * ksm.c
+ *
+ * The stable tree is a hashed page table from content hash to frame (the
+ * 64-bit hash is split into its (pid, vpn) halves). Pages sharing a frame
+ * are chained through per-page links so eviction unmaps them all without a
+ * page table walk. Hashes stand in for contents, so equal hashes are equal
+ * pages; UINT64_MAX, the table's empty key, is folded onto UINT64_MAX - 1.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashpt.h"
+#include "ksm.h"
+
+struct ksm {
+    struct PTE *pt;
+    int frame_cnt;
+    uint64_t *content;      /* per frame */
+    int *mappers;           /* pages mapping the frame */
+    int *first;             /* first mapping page */
+    unsigned char *stable;  /* frame is in the stable tree */
+    int *next, *prev;       /* replacement list over frames, head newest */
+    int head, tail;
+    int *free_frames;       /* stack */
+    int nfree;
+    int *mnext, *mprev;     /* per page: other pages on the same frame */
+    int resident;           /* pages */
+    int hand;               /* scanner position */
+    struct vm_hpt tree;
+    struct vm_ksm_stats *st;
+};
+
+#define HI(h) ((int)(uint32_t)((h) >> 32))
+#define LO(h) ((int)(uint32_t)(h))
+
+void vm_ksm_defaults(struct vm_ksm_params *p) {
+    p->lru = 1;
+    p->scan_interval = 100;
+    p->pages_to_scan = 100;
+}
+
+static void frame_link(struct ksm *k, int f) {
+    k->prev[f] = -1;
+    k->next[f] = k->head;
+    if (k->head >= 0) k->prev[k->head] = f;
+    k->head = f;
+    if (k->tail < 0) k->tail = f;
+}
+
+static void frame_unlink(struct ksm *k, int f) {
+    if (k->prev[f] >= 0) k->next[k->prev[f]] = k->next[f];
+    else k->head = k->next[f];
+    if (k->next[f] >= 0) k->prev[k->next[f]] = k->prev[f];
+    else k->tail = k->prev[f];
+}
+
+static void map_add(struct ksm *k, int f, int page) {
+    k->mprev[page] = -1;
+    k->mnext[page] = k->first[f];
+    if (k->first[f] >= 0) k->mprev[k->first[f]] = page;
+    k->first[f] = page;
+    k->mappers[f]++;
+    k->pt[page].is_valid = 1;
+    k->pt[page].frame_number = f;
+}
+
+static void map_del(struct ksm *k, int f, int page) {
+    if (k->mprev[page] >= 0) k->mnext[k->mprev[page]] = k->mnext[page];
+    else k->first[f] = k->mnext[page];
+    if (k->mnext[page] >= 0) k->mprev[k->mnext[page]] = k->mprev[page];
+    k->mappers[f]--;
+}
+
+static void unstable(struct ksm *k, int f) {
+    if (!k->stable[f]) return;
+    vm_hpt_remove(&k->tree, HI(k->content[f]), LO(k->content[f]));
+    k->stable[f] = 0;
+}
+
+static void release_frame(struct ksm *k, int f) {
+    unstable(k, f);
+    frame_unlink(k, f);
+    k->free_frames[k->nfree++] = f;
+}
+
+static void evict(struct ksm *k, int f) {
+    for (int page = k->first[f]; page >= 0; page = k->mnext[page]) {
+        struct PTE *p = &k->pt[page];
+        p->is_valid = 0;
+        p->frame_number = -1;
+        p->arrival_timestamp = 0;
+        p->last_access_timestamp = 0;
+        p->reference_count = 0;
+        k->resident--;
+    }
+    k->first[f] = -1;
+    k->mappers[f] = 0;
+    release_frame(k, f);
+}
+
+/* A free frame holding content, evicting if none is left; -1 without frames */
+static int get_frame(struct ksm *k, uint64_t content) {
+    if (!k->nfree && k->tail >= 0) evict(k, k->tail);
+    if (!k->nfree) return -1;
+    int f = k->free_frames[--k->nfree];
+    k->content[f] = content;
+    k->first[f] = -1;
+    k->mappers[f] = 0;
+    k->stable[f] = 0;
+    frame_link(k, f);
+    return f;
+}
+
+/* Visit up to n frames: merge each into an equal stable frame, or make it
+ * the stable frame for its content */
+static int scan(struct ksm *k, int n) {
+    for (int i = 0; i < n && k->frame_cnt > 0; ++i) {
+        int f = k->hand;
+        k->hand = (k->hand + 1) % k->frame_cnt;
+        if (!k->mappers[f] || k->stable[f]) continue;
+        k->st->scanned++;
+        uint64_t c = k->content[f];
+        int g = vm_hpt_lookup(&k->tree, HI(c), LO(c));
+        if (g < 0) {
+            if (vm_hpt_insert(&k->tree, HI(c), LO(c), f) < 0) return -1;
+            k->stable[f] = 1;
+            continue;
+        }
+        while (k->first[f] >= 0) {
+            int page = k->first[f];
+            map_del(k, f, page);
+            map_add(k, g, page);
+            k->st->merged++;
+        }
+        release_frame(k, f);
+    }
+    return 0;
+}
+
+static void ksm_free(struct ksm *k) {
+    free(k->content);
+    free(k->mappers);
+    free(k->first);
+    free(k->stable);
+    free(k->next);
+    free(k->prev);
+    free(k->free_frames);
+    free(k->mnext);
+    free(k->mprev);
+    vm_hpt_free(&k->tree);
+}
+
+static int ksm_init(struct ksm *k, struct PTE *pt, int table_cnt, int frame_cnt,
+                    struct vm_ksm_stats *st) {
+    memset(k, 0, sizeof(*k));
+    k->pt = pt;
+    k->frame_cnt = frame_cnt > 0 ? frame_cnt : 0;
+    k->head = k->tail = -1;
+    k->st = st;
+    size_t n = (size_t)(frame_cnt > 0 ? frame_cnt : 1);
+    size_t t = (size_t)table_cnt;
+    k->content = malloc(sizeof(uint64_t) * n);
+    k->mappers = calloc(n, sizeof(int));
+    k->first = malloc(sizeof(int) * n);
+    k->stable = calloc(n, 1);
+    k->next = malloc(sizeof(int) * n);
+    k->prev = malloc(sizeof(int) * n);
+    k->free_frames = malloc(sizeof(int) * n);
+    k->mnext = malloc(sizeof(int) * t);
+    k->mprev = malloc(sizeof(int) * t);
+    if (vm_hpt_init(&k->tree, 1) < 0 || !k->content || !k->mappers || !k->first ||
+        !k->stable || !k->next || !k->prev || !k->free_frames || !k->mnext || !k->mprev) {
+        ksm_free(k);
+        return -1;
+    }
+    /* lowest frame handed out first */
+    for (int f = 0; f < k->frame_cnt; ++f) k->free_frames[k->nfree++] = k->frame_cnt - 1 - f;
+    return 0;
+}
+
+/* One reference to page, whose content is c afterwards */
+static void access_page(struct ksm *k, int page, uint64_t c, int timestamp, int lru) {
+    struct PTE *pte = &k->pt[page];
+    if (!pte->is_valid) {
+        k->st->faults++;
+        int f = get_frame(k, c);
+        if (f < 0) return;
+        map_add(k, f, page);
+        pte->arrival_timestamp = timestamp;
+        pte->last_access_timestamp = timestamp;
+        pte->reference_count = 1;
+        k->resident++;
+        return;
+    }
+    int f = pte->frame_number;
+    pte->last_access_timestamp = timestamp;
+    pte->reference_count += 1;
+    if (lru && k->head != f) {
+        frame_unlink(k, f);
+        frame_link(k, f);
+    }
+    if (k->content[f] == c) return;
+    if (k->mappers[f] == 1) {
+        /* private write: the frame leaves the stable tree until rescanned */
+        unstable(k, f);
+        k->content[f] = c;
+        return;
+    }
+    /* write to a merged page: copy it out */
+    k->st->cow_faults++;
+    map_del(k, f, page);
+    pte->is_valid = 0;
+    pte->frame_number = -1;
+    k->resident--;
+    int nf = get_frame(k, c);
+    if (nf < 0) return;
+    map_add(k, nf, page);
+    k->resident++;
+}
+
+int vm_ksm_run(struct PTE *page_table, int table_cnt, const int *refs, const uint64_t *content,
+               int reference_cnt, int frame_cnt, const struct vm_ksm_params *p,
+               struct vm_ksm_stats *stats) {
+    struct ksm k;
+    memset(stats, 0, sizeof(*stats));
+    if (table_cnt <= 0) return 0;
+    if (ksm_init(&k, page_table, table_cnt, frame_cnt, stats) < 0) return -1;
+    int rc = 0;
+
+    for (int i = 0; i < reference_cnt && rc == 0; ++i) {
+        int page = refs[i];
+        uint64_t c = content[i] == UINT64_MAX ? UINT64_MAX - 1 : content[i];
+
+        if (p->scan_interval > 0 && i % p->scan_interval == 0 && scan(&k, p->pages_to_scan) < 0)
+            rc = -1;
+        if (page < 0 || page >= table_cnt) stats->faults++;
+        else access_page(&k, page, c, i + 1, p->lru);
+
+        int saved = k.resident - (k.frame_cnt - k.nfree);
+        stats->saved_sum += saved;
+        if (saved > stats->peak_saved) stats->peak_saved = saved;
+        stats->saved = saved;
+    }
+    ksm_free(&k);
+    return rc < 0 ? -1 : (int)stats->faults;
+}
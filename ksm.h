@@ -0,0 +1,46 @@
+/*
+ * ksm.h
+ *
+ * Kernel samepage merging model. Every reference carries the content hash of
+ * its page after the access; a hash that differs from what the page held is
+ * a write. A ksmd-style scanner walks a few resident frames at a time and
+ * merges frames of equal content into one shared, write-protected frame, so
+ * a later write to any of its pages takes a COW (unmerge) fault.
+ *
+ * Replacement works on frames: a merged frame is one unit, touched by any of
+ * its pages and evicted with all of them.
+ */
+
+#ifndef KSM_H
+#define KSM_H
+
+#include <stdint.h>
+
+#include "oslabs.h"
+
+struct vm_ksm_params {
+    int lru;            /* 0: FIFO over frames, 1: LRU */
+    int scan_interval;  /* references between scanner runs, 0 disables merging */
+    int pages_to_scan;  /* frames visited per run */
+};
+
+void vm_ksm_defaults(struct vm_ksm_params *p);
+
+struct vm_ksm_stats {
+    long long faults;       /* page not resident */
+    long long cow_faults;   /* write to a merged page */
+    long long merged;       /* pages moved onto a shared frame */
+    long long scanned;
+    double saved_sum;       /* frames saved, summed per reference */
+    int peak_saved;
+    int saved;              /* at the end */
+};
+
+/* Replay refs with content[i] the hash of refs[i] after the access, on a
+ * fresh page table with frame_cnt frames. Returns the fault count (not
+ * counting COW faults) or -1 if out of memory. */
+int vm_ksm_run(struct PTE *page_table, int table_cnt, const int *refs, const uint64_t *content,
+               int reference_cnt, int frame_cnt, const struct vm_ksm_params *p,
+               struct vm_ksm_stats *stats);
+
+#endif /* KSM_H */
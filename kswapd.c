@@ -0,0 +1,84 @@
+/*
+ * kswapd.c
+ *
+ * The reclaimer runs between references: it earns rate pages of credit per
+ * reference while awake and spends whole pages of it. A fault finding the
+ * free count at or below min reclaims synchronously until it is above min;
+ * with min 0 that is the single eviction the engine would have done inline.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "kswapd.h"
+
+void vm_kswapd_defaults(struct vm_kswapd_params *kp, int frame_cnt) {
+    kp->min = 0;
+    kp->low = frame_cnt / 32 > 1 ? frame_cnt / 32 : 1;
+    kp->high = frame_cnt / 16 > 2 ? frame_cnt / 16 : 2;
+    kp->rate = 1.0;
+}
+
+int vm_kswapd_run(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                  const int *refs, int reference_cnt, const int *frame_pool, int frame_cnt,
+                  const struct vm_kswapd_params *kp, struct vm_kswapd_stats *st) {
+    memset(st, 0, sizeof(*st));
+    if (table_cnt <= 0) return 0;
+    unsigned char *reclaimed = calloc((size_t)table_cnt, 1);
+    if (!reclaimed) return -1;
+    struct vm_engine e;
+    if (vm_engine_init(&e, ops, page_table, table_cnt, frame_pool, frame_cnt) < 0) {
+        free(reclaimed);
+        return -1;
+    }
+
+    int awake = 0;
+    double credit = 0.0;
+    int rc = 0;
+    for (int i = 0; i < reference_cnt; ++i) {
+        int page = refs[i];
+        int timestamp = i + 1;
+        int miss = page >= 0 && page < table_cnt && !page_table[page].is_valid;
+
+        if (miss) {
+            if (reclaimed[page]) {
+                st->refaults++;
+                reclaimed[page] = 0;
+            }
+            if (e.free_cnt <= kp->min && e.resident > 0) {
+                st->direct_stalls++;
+                while (e.free_cnt <= kp->min && vm_engine_evict(&e, timestamp) >= 0)
+                    st->direct_reclaimed++;
+            }
+        }
+
+        int r = vm_engine_access(&e, page, timestamp);
+        if (r < 0) {
+            rc = -1;
+            break;
+        }
+        st->faults += r;
+
+        if (!awake && e.free_cnt < kp->low) {
+            awake = 1;
+            st->wakeups++;
+        }
+        if (awake) {
+            credit += kp->rate;
+            while (credit >= 1.0 && e.free_cnt < kp->high) {
+                int victim = vm_engine_evict(&e, timestamp);
+                if (victim < 0) break;
+                reclaimed[victim] = 1;
+                st->background_reclaimed++;
+                credit -= 1.0;
+            }
+            if (e.free_cnt >= kp->high || e.resident == 0) {
+                awake = 0;
+                credit = 0.0;
+            }
+        }
+    }
+    vm_engine_destroy(&e);
+    free(reclaimed);
+    return rc < 0 ? -1 : st->faults;
+}
@@ -0,0 +1,40 @@
+/*
+ * kswapd.h
+ *
+ * Background reclaim with zone-style watermarks, layered on vm_engine. Free
+ * frames are the engine's free ring; a reclaimer woken below the low
+ * watermark evicts the policy's victims at a limited rate until the high
+ * watermark is reached, so that faults find a free frame instead of
+ * reclaiming synchronously.
+ */
+
+#ifndef KSWAPD_H
+#define KSWAPD_H
+
+#include "vm_engine.h"
+
+struct vm_kswapd_params {
+    int min;        /* free frames at or below which a fault reclaims directly */
+    int low;        /* wake the background reclaimer below this */
+    int high;       /* background reclaim stops at this */
+    double rate;    /* pages the background reclaimer frees per reference */
+};
+
+struct vm_kswapd_stats {
+    int faults;
+    long long direct_stalls;        /* faults that had to reclaim themselves */
+    long long direct_reclaimed;
+    long long background_reclaimed;
+    long long wakeups;
+    long long refaults;             /* faults on pages the background reclaimer evicted */
+};
+
+/* min 0, low and high at 1/32 and 1/16 of frame_cnt (at least 1 and 2), rate 1 */
+void vm_kswapd_defaults(struct vm_kswapd_params *kp, int frame_cnt);
+
+/* Replay refs like vm_policy_run with background reclaim; the fault count or -1 */
+int vm_kswapd_run(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                  const int *refs, int reference_cnt, const int *frame_pool, int frame_cnt,
+                  const struct vm_kswapd_params *kp, struct vm_kswapd_stats *st);
+
+#endif /* KSWAPD_H */
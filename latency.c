@@ -0,0 +1,121 @@
+/*
+ * latency.c
+ *
+ * Histogram layout: values below VM_HDR_SUB get a slot each; above that, each
+ * power of two [2^k, 2^(k+1)) is split into VM_HDR_HALF equal slots, so slot
+ * width grows with magnitude while relative precision stays fixed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "latency.h"
+
+void vm_hdr_init(struct vm_hdr *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+static int hdr_slot(uint64_t v) {
+    if (v < VM_HDR_SUB) return (int)v;
+    int shift = 63 - __builtin_clzll(v) - (VM_HDR_SUB_BITS - 1);
+    return (shift + 1) * VM_HDR_HALF + (int)(v >> shift) - VM_HDR_HALF;
+}
+
+/* Largest value that lands in slot */
+static uint64_t hdr_slot_top(int slot) {
+    if (slot < VM_HDR_SUB) return (uint64_t)slot;
+    int shift = slot / VM_HDR_HALF - 1;
+    uint64_t sub = (uint64_t)(slot % VM_HDR_HALF + VM_HDR_HALF);
+    return ((sub + 1) << shift) - 1;
+}
+
+void vm_hdr_record(struct vm_hdr *h, uint64_t value) {
+    h->counts[hdr_slot(value)]++;
+    h->total++;
+    h->sum += (double)value;
+    if (value > h->max) h->max = value;
+}
+
+uint64_t vm_hdr_quantile(const struct vm_hdr *h, double q) {
+    if (!h->total) return 0;
+    uint64_t rank = (uint64_t)(q * (double)h->total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > h->total) rank = h->total;
+    uint64_t seen = 0;
+    for (int i = 0; i < VM_HDR_SLOTS; ++i) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t top = hdr_slot_top(i);
+            return top < h->max ? top : h->max;
+        }
+    }
+    return h->max;
+}
+
+void vm_latency_defaults(struct vm_latency_costs *c) {
+    c->hit = 80;            /* DRAM access */
+    c->walk = 40;           /* page walk mostly served from cache */
+    c->fault = 25000;       /* swap-in from NVMe */
+    c->reclaim = 15000;     /* synchronous writeback of the victim */
+    c->tlb_entries = 64;
+}
+
+/* ---------------- replay ---------------- */
+
+struct tlb {
+    int *slots;     /* page cached in each entry, -1 if empty */
+    int entries;
+};
+
+static void tlb_on_evict(void *ctx, int page, int timestamp) {
+    struct tlb *t = ctx;
+    (void)timestamp;
+    /* shootdown: the evicted page's translation is gone */
+    if (t->slots[page % t->entries] == page) t->slots[page % t->entries] = -1;
+}
+
+int vm_latency_run(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                   const int *refs, int reference_cnt, const int *frame_pool, int frame_cnt,
+                   const struct vm_latency_costs *c, struct vm_hdr *h) {
+    if (table_cnt <= 0) return 0;
+    struct tlb tlb;
+    tlb.entries = c->tlb_entries > 0 ? c->tlb_entries : 1;
+    tlb.slots = malloc(sizeof(int) * (size_t)tlb.entries);
+    if (!tlb.slots) return -1;
+    for (int i = 0; i < tlb.entries; ++i) tlb.slots[i] = -1;
+
+    struct vm_engine e;
+    if (vm_engine_init(&e, ops, page_table, table_cnt, frame_pool, frame_cnt) < 0) {
+        free(tlb.slots);
+        return -1;
+    }
+    struct vm_observer obs = { &tlb, NULL, tlb_on_evict };
+    e.obs = &obs;
+
+    int faults = 0;
+    for (int i = 0; i < reference_cnt; ++i) {
+        int page = refs[i];
+        int direct = e.free_cnt == 0 && e.resident > 0 && page >= 0 && page < table_cnt &&
+                     !page_table[page].is_valid;
+        int r = vm_engine_access(&e, page, i + 1);
+        if (r < 0) {
+            faults = -1;
+            break;
+        }
+        uint64_t ns = c->hit;
+        if (page >= 0 && page < table_cnt) {
+            int slot = page % tlb.entries;
+            if (tlb.slots[slot] != page) {
+                ns += c->walk;
+                tlb.slots[slot] = page;
+            }
+        }
+        if (r) ns += c->fault;
+        if (direct) ns += c->reclaim;
+        vm_hdr_record(h, ns);
+        faults += r;
+    }
+    vm_engine_destroy(&e);
+    free(tlb.slots);
+    return faults;
+}
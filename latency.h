@@ -0,0 +1,55 @@
+/*
+ * latency.h
+ *
+ * Per-access simulated latency: a cost model charged on top of a vm_engine
+ * replay, recorded into a log-linear (HDR-style) histogram so that tail
+ * percentiles are cheap to read back.
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+#include "vm_engine.h"
+
+/* 2^7 linear slots per power of two, each 1/128 of it wide: under 1% relative
+ * error at any magnitude */
+#define VM_HDR_SUB_BITS 8
+#define VM_HDR_SUB (1 << VM_HDR_SUB_BITS)
+#define VM_HDR_HALF (VM_HDR_SUB / 2)
+#define VM_HDR_SLOTS ((64 - VM_HDR_SUB_BITS + 2) * VM_HDR_HALF)
+
+struct vm_hdr {
+    uint64_t counts[VM_HDR_SLOTS];
+    uint64_t total;
+    uint64_t max;
+    double sum;
+};
+
+void vm_hdr_init(struct vm_hdr *h);
+void vm_hdr_record(struct vm_hdr *h, uint64_t value);
+
+/* Smallest recorded value v with at least q of all records <= v (within the
+ * bucket's precision); 0 for an empty histogram */
+uint64_t vm_hdr_quantile(const struct vm_hdr *h, double q);
+
+/* Nanoseconds per event. An access always pays hit; a TLB miss adds walk; a
+ * fault adds fault; a fault that had to evict synchronously adds reclaim. */
+struct vm_latency_costs {
+    uint64_t hit;
+    uint64_t walk;
+    uint64_t fault;
+    uint64_t reclaim;
+    int tlb_entries;    /* direct mapped, indexed by page modulo entries */
+};
+
+void vm_latency_defaults(struct vm_latency_costs *c);
+
+/* Replay refs like vm_policy_run, recording every access into h (initialised
+ * by the caller). Returns the fault count or -1. */
+int vm_latency_run(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                   const int *refs, int reference_cnt, const int *frame_pool, int frame_cnt,
+                   const struct vm_latency_costs *c, struct vm_hdr *h);
+
+#endif /* LATENCY_H */
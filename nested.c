@@ -0,0 +1,133 @@
+/*
+ * nested.c
+ *
+ * Two vm_engines: the guest's over its page table, the host's over the EPT
+ * (one entry per guest frame). Observers keep the TLB coherent with both:
+ * a guest eviction drops the page's entry, a host eviction drops the entry
+ * of whichever guest page sits in that guest frame.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nested.h"
+
+void vm_nested_defaults(struct vm_nested_params *p) {
+    p->guest_levels = 4;
+    p->host_levels = 4;
+    p->tlb_entries = 64;
+}
+
+struct nested {
+    struct vm_engine guest;
+    struct vm_engine host;
+    struct PTE *gpt;        /* guest page table */
+    struct PTE *ept;
+    int *gframe_page;       /* guest page in each guest frame, -1 if none */
+    int *tlb;               /* guest page cached per entry, -1 if empty */
+    int tlb_entries;
+    int failed;
+    struct vm_nested_stats *st;
+};
+
+static void tlb_drop(struct nested *n, int page) {
+    if (page >= 0 && n->tlb[page % n->tlb_entries] == page) n->tlb[page % n->tlb_entries] = -1;
+}
+
+/* The guest writes the victim's frame to its swap, which needs the frame
+ * resident on the host */
+static void guest_on_evict(void *ctx, int page, int timestamp) {
+    struct nested *n = ctx;
+    int gframe = n->gpt[page].frame_number;
+    tlb_drop(n, page);
+    n->gframe_page[gframe] = -1;
+    int r = vm_engine_access(&n->host, gframe, timestamp);
+    if (r < 0) n->failed = 1;
+    if (r == 1) {
+        n->st->host_faults++;
+        n->st->double_paging++;
+    }
+}
+
+static void host_on_evict(void *ctx, int gframe, int timestamp) {
+    struct nested *n = ctx;
+    (void)timestamp;
+    tlb_drop(n, n->gframe_page[gframe]);
+}
+
+static int *identity_pool(int cnt) {
+    int *pool = malloc(sizeof(int) * (size_t)(cnt > 0 ? cnt : 1));
+    for (int f = 0; pool && f < cnt; ++f) pool[f] = f;
+    return pool;
+}
+
+int vm_nested_run(const struct vm_policy_ops *guest, struct PTE *page_table, int table_cnt,
+                  int guest_frames, const struct vm_policy_ops *host, int host_frames,
+                  const int *refs, int reference_cnt, const struct vm_nested_params *p,
+                  struct vm_nested_stats *stats) {
+    struct nested n;
+    memset(stats, 0, sizeof(*stats));
+    memset(&n, 0, sizeof(n));
+    if (table_cnt <= 0) return 0;
+    n.st = stats;
+    n.tlb_entries = p->tlb_entries > 0 ? p->tlb_entries : 1;
+    n.gpt = page_table;
+    n.ept = calloc((size_t)(guest_frames > 0 ? guest_frames : 1), sizeof(struct PTE));
+    n.gframe_page = malloc(sizeof(int) * (size_t)(guest_frames > 0 ? guest_frames : 1));
+    n.tlb = malloc(sizeof(int) * (size_t)n.tlb_entries);
+    int *gpool = identity_pool(guest_frames);
+    int *hpool = identity_pool(host_frames);
+    struct vm_observer gobs = { &n, NULL, guest_on_evict };
+    struct vm_observer hobs = { &n, NULL, host_on_evict };
+    int rc = -1, ginit = -1, hinit = -1;
+    if (!n.ept || !n.gframe_page || !n.tlb || !gpool || !hpool) goto done;
+    ginit = vm_engine_init(&n.guest, guest, n.gpt, table_cnt, gpool, guest_frames);
+    hinit = vm_engine_init(&n.host, host, n.ept, guest_frames, hpool, host_frames);
+    if (ginit < 0 || hinit < 0) goto done;
+    n.guest.obs = &gobs;
+    n.host.obs = &hobs;
+    for (int f = 0; f < guest_frames; ++f) n.gframe_page[f] = -1;
+    for (int e = 0; e < n.tlb_entries; ++e) n.tlb[e] = -1;
+
+    int walk2d = (p->guest_levels + 1) * (p->host_levels + 1) - 1;
+    for (int i = 0; i < reference_cnt && !n.failed; ++i) {
+        int page = refs[i];
+        int timestamp = i + 1;
+        if (page < 0 || page >= table_cnt) {
+            stats->guest_faults++;
+            continue;
+        }
+        if (n.tlb[page % n.tlb_entries] != page) {
+            stats->tlb_misses++;
+            stats->walk_refs += walk2d;
+            stats->native_walk_refs += p->guest_levels;
+        }
+        int r = vm_engine_access(&n.guest, page, timestamp);
+        if (r < 0) {
+            n.failed = 1;
+            break;
+        }
+        stats->guest_faults += r;
+        if (!n.gpt[page].is_valid) continue;
+        int gframe = n.gpt[page].frame_number;
+        n.gframe_page[gframe] = page;
+        /* the data access itself, or the guest's swap-in into this frame */
+        r = vm_engine_access(&n.host, gframe, timestamp);
+        if (r < 0) {
+            n.failed = 1;
+            break;
+        }
+        stats->host_faults += r;
+        n.tlb[page % n.tlb_entries] = page;
+    }
+    rc = n.failed ? -1 : (int)stats->guest_faults;
+done:
+    if (ginit == 0) vm_engine_destroy(&n.guest);
+    if (hinit == 0) vm_engine_destroy(&n.host);
+    free(n.ept);
+    free(n.gframe_page);
+    free(n.tlb);
+    free(gpool);
+    free(hpool);
+    return rc;
+}
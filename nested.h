@@ -0,0 +1,49 @@
+/*
+ * nested.h
+ *
+ * Nested paging (EPT/NPT): a guest maps its virtual pages onto guest
+ * physical frames with its own policy and frame pool, and the host maps
+ * those guest frames onto host frames with another policy and a smaller or
+ * equal pool. One guest reference stream drives both levels.
+ *
+ * A TLB miss pays the two-dimensional walk: each of the guest's levels is a
+ * guest physical address the host has to walk too, so g guest and h host
+ * levels cost (g + 1)(h + 1) - 1 memory references instead of g. When the
+ * guest evicts a page whose frame the host has already swapped out, the host
+ * must fault it back in just so the guest can write it to its own swap:
+ * double paging.
+ */
+
+#ifndef NESTED_H
+#define NESTED_H
+
+#include "vm_engine.h"
+
+struct vm_nested_params {
+    int guest_levels;
+    int host_levels;
+    int tlb_entries;    /* direct mapped by guest page */
+};
+
+void vm_nested_defaults(struct vm_nested_params *p);
+
+struct vm_nested_stats {
+    long long guest_faults;
+    long long host_faults;      /* guest frame not resident on the host */
+    long long double_paging;    /* host faults taken to let the guest evict */
+    long long tlb_misses;
+    long long walk_refs;        /* memory references spent in 2D walks */
+    long long native_walk_refs; /* the same misses walked without nesting */
+};
+
+/* Replay refs on a fresh guest page_table with guest_frames guest physical
+ * frames under guest, backed by host_frames host frames under host. The
+ * guest level alone behaves like vm_policy_run. Returns the guest fault
+ * count (host faults are in stats), or -1 if an engine cannot be set up or
+ * finds no victim. */
+int vm_nested_run(const struct vm_policy_ops *guest, struct PTE *page_table, int table_cnt,
+                  int guest_frames, const struct vm_policy_ops *host, int host_frames,
+                  const int *refs, int reference_cnt, const struct vm_nested_params *p,
+                  struct vm_nested_stats *stats);
+
+#endif /* NESTED_H */
@@ -0,0 +1,62 @@
+/*
+ * oslabs.h
+ *
+ * Page table entry and page replacement functions of the virtual memory lab.
+ * The array sizes in the prototypes are the lab's nominal limits; the
+ * functions themselves work on arrays of any length.
+ */
+
+#ifndef OSLABS_H
+#define OSLABS_H
+
+#define TABLEMAX 100
+#define POOLMAX 100
+#define REFERENCEMAX 100
+
+struct PTE {
+    int is_valid;
+    int frame_number;
+    int arrival_timestamp;
+    int last_access_timestamp;
+    int reference_count;
+};
+
+/* Single access: returns the frame holding page_number, or -1 */
+int process_page_access_fifo(struct PTE *page_table, int *table_cnt, int page_number,
+                             int *frame_pool, int *frame_cnt, int current_timestamp);
+int process_page_access_lru(struct PTE *page_table, int *table_cnt, int page_number,
+                            int *frame_pool, int *frame_cnt, int current_timestamp);
+int process_page_access_lfu(struct PTE *page_table, int *table_cnt, int page_number,
+                            int *frame_pool, int *frame_cnt, int current_timestamp);
+
+/* Whole reference string: returns the number of page faults. A page outside
+ * [0, table_cnt) counts as a fault and is otherwise ignored. */
+int count_page_faults_fifo(struct PTE *page_table, int table_cnt,
+                           int refrence_string[REFERENCEMAX], int reference_cnt,
+                           int frame_pool[POOLMAX], int frame_cnt);
+int count_page_faults_lru(struct PTE *page_table, int table_cnt,
+                          int refrence_string[REFERENCEMAX], int reference_cnt,
+                          int frame_pool[POOLMAX], int frame_cnt);
+int count_page_faults_lfu(struct PTE *page_table, int table_cnt,
+                          int refrence_string[REFERENCEMAX], int reference_cnt,
+                          int frame_pool[POOLMAX], int frame_cnt);
+int count_page_faults_mru(struct PTE *page_table, int table_cnt,
+                          int refrence_string[REFERENCEMAX], int reference_cnt,
+                          int frame_pool[POOLMAX], int frame_cnt);
+/* Random keeps a resident list on the heap: -1 if it cannot be allocated */
+int count_page_faults_random(struct PTE *page_table, int table_cnt,
+                             int refrence_string[REFERENCEMAX], int reference_cnt,
+                             int frame_pool[POOLMAX], int frame_cnt);
+int count_page_faults_random_seeded(struct PTE *page_table, int table_cnt,
+                                    int refrence_string[REFERENCEMAX], int reference_cnt,
+                                    int frame_pool[POOLMAX], int frame_cnt, unsigned int seed);
+
+/* Clustered LRU; *io_ops receives the swap I/O operation count. Evicted
+ * frames are appended to frame_pool, which must hold frame_cnt plus the
+ * pages already resident in page_table. */
+int count_page_faults_cluster(struct PTE *page_table, int table_cnt,
+                              int refrence_string[REFERENCEMAX], int reference_cnt,
+                              int frame_pool[POOLMAX], int frame_cnt,
+                              int cluster_size, int read_cluster, int *io_ops);
+
+#endif /* OSLABS_H */
@@ -0,0 +1,154 @@
+/*
+ * pagesize.c
+ *
+ * Each size keeps an LRU list over its frames and a hashed page table from
+ * page to frame (pages are 64-bit, so the key is split into the table's
+ * (pid, vpn) halves). A second table per size, and one for lines, records
+ * what has ever been touched.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashpt.h"
+#include "pagesize.h"
+
+struct lru_size {
+    struct vm_pagesize_result *res;
+    int frames;
+    int used;
+    uint64_t *page;     /* per frame */
+    int *prev, *next;   /* LRU list, head most recent */
+    int head, tail;
+    struct vm_hpt map;
+    struct vm_hpt seen;
+    uint64_t last;      /* page of the previous reference */
+};
+
+#define HI(p) ((int)(uint32_t)((p) >> 32))
+#define LO(p) ((int)(uint32_t)(p))
+
+static void unlink_frame(struct lru_size *s, int f) {
+    if (s->prev[f] >= 0) s->next[s->prev[f]] = s->next[f];
+    else s->head = s->next[f];
+    if (s->next[f] >= 0) s->prev[s->next[f]] = s->prev[f];
+    else s->tail = s->prev[f];
+}
+
+static void push_head(struct lru_size *s, int f) {
+    s->prev[f] = -1;
+    s->next[f] = s->head;
+    if (s->head >= 0) s->prev[s->head] = f;
+    s->head = f;
+    if (s->tail < 0) s->tail = f;
+}
+
+/* Mark a previously untouched key; -1 if out of memory */
+static int note_seen(struct vm_hpt *h, uint64_t key, long long *distinct) {
+    if (vm_hpt_lookup(h, HI(key), LO(key)) >= 0) return 0;
+    (*distinct)++;
+    return vm_hpt_insert(h, HI(key), LO(key), 1);
+}
+
+static int access_page(struct lru_size *s, uint64_t page) {
+    int f = vm_hpt_lookup(&s->map, HI(page), LO(page));
+    if (f >= 0) {
+        if (s->head != f) {
+            unlink_frame(s, f);
+            push_head(s, f);
+        }
+        return 0;
+    }
+    /* only a fault can touch a page for the first time */
+    if (note_seen(&s->seen, page, &s->res->pages) < 0) return -1;
+    s->res->faults++;
+    if (s->frames <= 0) return 0;
+    if (s->used < s->frames) {
+        f = s->used++;
+    } else {
+        f = s->tail;
+        unlink_frame(s, f);
+        vm_hpt_remove(&s->map, HI(s->page[f]), LO(s->page[f]));
+    }
+    s->page[f] = page;
+    push_head(s, f);
+    return vm_hpt_insert(&s->map, HI(page), LO(page), f);
+}
+
+static void size_free(struct lru_size *s) {
+    free(s->page);
+    free(s->prev);
+    free(s->next);
+    vm_hpt_free(&s->map);
+    vm_hpt_free(&s->seen);
+}
+
+static int size_init(struct lru_size *s, struct vm_pagesize_result *res, uint64_t mem_bytes) {
+    memset(s, 0, sizeof(*s));
+    s->res = res;
+    uint64_t frames = mem_bytes >> res->shift;
+    s->frames = frames > 0x7fffffff ? 0x7fffffff : (int)frames;
+    res->frames = s->frames;
+    res->faults = res->pages = 0;
+    size_t n = (size_t)(s->frames > 0 ? s->frames : 1);
+    s->page = malloc(sizeof(uint64_t) * n);
+    s->prev = malloc(sizeof(int) * n);
+    s->next = malloc(sizeof(int) * n);
+    s->head = s->tail = -1;
+    s->last = UINT64_MAX;
+    int rc = s->page && s->prev && s->next ? 0 : -1;
+    if (vm_hpt_init(&s->map, 1) < 0) rc = -1;
+    if (vm_hpt_init(&s->seen, 1) < 0) rc = -1;
+    return rc;
+}
+
+int vm_pagesize_run(const uint64_t *addrs, long long reference_cnt, uint64_t mem_bytes,
+                    struct vm_pagesize_result *res, int nsizes, uint64_t *touched) {
+    if (nsizes < 1 || nsizes > VM_PAGESIZE_MAX) return -1;
+    for (int k = 0; k < nsizes; ++k)
+        if (res[k].shift < VM_LINE_SHIFT || res[k].shift >= 63) return -1;
+    struct lru_size sizes[VM_PAGESIZE_MAX];
+    struct lru_size *order[VM_PAGESIZE_MAX];
+    struct vm_hpt lines;
+    long long nlines = 0;
+    int rc = vm_hpt_init(&lines, 1);
+    int ready = 0;
+    for (; ready < nsizes && rc == 0; ++ready) {
+        if (size_init(&sizes[ready], &res[ready], mem_bytes) < 0) rc = -1;
+    }
+    /* smallest page first, so a repeat at one size ends the loop for this address */
+    for (int i = 0; i < nsizes && rc == 0; ++i) {
+        int j = i;
+        for (; j > 0 && order[j - 1]->res->shift > sizes[i].res->shift; --j)
+            order[j] = order[j - 1];
+        order[j] = &sizes[i];
+    }
+
+    for (long long i = 0; rc == 0 && i < reference_cnt; ++i) {
+        uint64_t addr = addrs[i];
+        if (note_seen(&lines, addr >> VM_LINE_SHIFT, &nlines) < 0) rc = -1;
+        for (int k = 0; rc == 0 && k < nsizes; ++k) {
+            struct lru_size *s = order[k];
+            uint64_t page = addr >> s->res->shift;
+            if (page == s->last) {
+                /* MRU hit here and at every larger size that has a frame at all;
+                 * frame counts only shrink along order */
+                for (int j = k; j < nsizes; ++j)
+                    if (order[j]->frames <= 0) order[j]->res->faults++;
+                break;
+            }
+            s->last = page;
+            if (access_page(s, page) < 0) rc = -1;
+        }
+    }
+
+    uint64_t bytes = (uint64_t)nlines << VM_LINE_SHIFT;
+    for (int k = 0; k < nsizes; ++k) {
+        res[k].footprint = (uint64_t)res[k].pages << res[k].shift;
+        res[k].waste = res[k].footprint > bytes ? res[k].footprint - bytes : 0;
+    }
+    if (touched) *touched = bytes;
+    for (int k = 0; k < ready; ++k) size_free(&sizes[k]);
+    vm_hpt_free(&lines);
+    return rc;
+}
@@ -0,0 +1,36 @@
+/*
+ * pagesize.h
+ *
+ * Page size exploration: replay one trace of byte addresses at several page
+ * sizes at once under LRU, with the same physical memory for each. Every
+ * address is decoded once; its page at each size is a shift away, and an
+ * address that stays on the previous page at one size stays on it at every
+ * larger size too, so those sizes are skipped for it.
+ */
+
+#ifndef PAGESIZE_H
+#define PAGESIZE_H
+
+#include <stdint.h>
+
+#define VM_PAGESIZE_MAX 8
+#define VM_LINE_SHIFT 6     /* touched memory is counted in 64-byte lines */
+
+struct vm_pagesize_result {
+    unsigned int shift;     /* in: log2 of the page size */
+    int frames;             /* mem_bytes / page size */
+    long long faults;
+    long long pages;        /* distinct pages touched */
+    uint64_t footprint;     /* pages * page size */
+    uint64_t waste;         /* footprint minus the bytes of lines touched */
+};
+
+/* Fill res[0..nsizes) (shift set by the caller, at most VM_PAGESIZE_MAX
+ * sizes, any order). *touched receives the bytes of distinct lines touched.
+ * Returns 0, or -1 if out of memory, nsizes is out of range or a page is
+ * smaller than a line. Pages stay below 2^58, clear of the hashed tables'
+ * empty key. */
+int vm_pagesize_run(const uint64_t *addrs, long long reference_cnt, uint64_t mem_bytes,
+                    struct vm_pagesize_result *res, int nsizes, uint64_t *touched);
+
+#endif /* PAGESIZE_H */
@@ -0,0 +1,121 @@
+/*
+ * phase.c
+ *
+ * The observer callback cannot report failure, so an allocation failure while
+ * closing an interval sets the tracker's interval to 0 and vm_phase_finish
+ * returns -1.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "phase.h"
+
+int vm_phase_init(struct vm_phase_tracker *pt, int interval, double threshold) {
+    memset(pt, 0, sizeof(*pt));
+    if (interval < 1) return -1;
+    pt->interval = interval;
+    pt->threshold = threshold;
+    pt->current = -1;
+    return 0;
+}
+
+void vm_phase_free(struct vm_phase_tracker *pt) {
+    free(pt->phases);
+    free(pt->timeline);
+    memset(pt, 0, sizeof(*pt));
+}
+
+double vm_phase_distance(const uint64_t *a, const uint64_t *b) {
+    int both = 0, either = 0;
+    for (int i = 0; i < VM_PHASE_SIG_WORDS; ++i) {
+        both += __builtin_popcountll(a[i] & b[i]);
+        either += __builtin_popcountll(a[i] | b[i]);
+    }
+    return either ? 1.0 - (double)both / either : 0.0;
+}
+
+/* Phase whose signature is closest to sig within the threshold, or -1. The
+ * current phase wins ties so that a steady state does not flap. */
+static int match_phase(const struct vm_phase_tracker *pt, const uint64_t *sig) {
+    int best = -1;
+    double best_d = pt->threshold;
+    if (pt->current >= 0) {
+        double d = vm_phase_distance(pt->phases[pt->current].sig, sig);
+        if (d <= best_d) {
+            best = pt->current;
+            best_d = d;
+        }
+    }
+    for (int i = 0; i < pt->nphases; ++i) {
+        if (i == pt->current) continue;
+        double d = vm_phase_distance(pt->phases[i].sig, sig);
+        if (d < best_d) {
+            best = i;
+            best_d = d;
+        }
+    }
+    return best;
+}
+
+static int close_interval(struct vm_phase_tracker *pt) {
+    int id = match_phase(pt, pt->sig);
+    if (id < 0) {
+        if (pt->nphases == pt->phase_cap) {
+            int cap = pt->phase_cap ? 2 * pt->phase_cap : 8;
+            struct vm_phase *p = realloc(pt->phases, sizeof(*p) * (size_t)cap);
+            if (!p) return -1;
+            pt->phases = p;
+            pt->phase_cap = cap;
+        }
+        id = pt->nphases++;
+        memset(&pt->phases[id], 0, sizeof(pt->phases[id]));
+        memcpy(pt->phases[id].sig, pt->sig, sizeof(pt->sig));
+    }
+    if (pt->ntimeline == pt->timeline_cap) {
+        int cap = pt->timeline_cap ? 2 * pt->timeline_cap : 64;
+        int *t = realloc(pt->timeline, sizeof(int) * (size_t)cap);
+        if (!t) return -1;
+        pt->timeline = t;
+        pt->timeline_cap = cap;
+    }
+    pt->timeline[pt->ntimeline++] = id;
+
+    struct vm_phase *ph = &pt->phases[id];
+    ph->intervals++;
+    ph->references += pt->fill;
+    ph->faults += pt->faults;
+    pt->current = id;
+    memset(pt->sig, 0, sizeof(pt->sig));
+    pt->fill = 0;
+    pt->faults = 0;
+    return 0;
+}
+
+int vm_phase_access(struct vm_phase_tracker *pt, int page, int fault) {
+    if (pt->interval < 1) return -1;
+    /* Fibonacci hashing spreads neighbouring pages over the signature */
+    unsigned h = ((unsigned)page * 2654435769u) >> (32 - VM_PHASE_SIG_ORDER);
+    pt->sig[h / 64] |= 1ull << (h % 64);
+    pt->faults += fault;
+    if (++pt->fill < pt->interval) return 0;
+    if (close_interval(pt) == 0) return 0;
+    pt->interval = 0;
+    return -1;
+}
+
+int vm_phase_finish(struct vm_phase_tracker *pt) {
+    if (pt->interval < 1) return -1;
+    return pt->fill ? close_interval(pt) : 0;
+}
+
+static void phase_on_access(void *ctx, int page, int timestamp, int fault) {
+    (void)timestamp;
+    vm_phase_access(ctx, page, fault);
+}
+
+void vm_phase_observer(struct vm_phase_tracker *pt, struct vm_observer *obs) {
+    obs->ctx = pt;
+    obs->on_access = phase_on_access;
+    obs->on_evict = NULL;
+}
@@ -0,0 +1,63 @@
+/*
+ * phase.h
+ *
+ * Online phase detection over a reference stream. Every interval of
+ * references is summarised as a working-set signature (a bit vector of hashed
+ * page numbers); an interval whose Jaccard distance from the current phase's
+ * signature exceeds the threshold starts a phase change, and is matched
+ * against earlier phases so that recurring phases keep their id. Faults seen
+ * through the observer hook are attributed to the phase of their interval.
+ */
+
+#ifndef PHASE_H
+#define PHASE_H
+
+#include <stdint.h>
+
+#include "vm_engine.h"
+
+#define VM_PHASE_SIG_ORDER 10
+#define VM_PHASE_SIG_BITS (1 << VM_PHASE_SIG_ORDER)
+#define VM_PHASE_SIG_WORDS (VM_PHASE_SIG_BITS / 64)
+
+struct vm_phase {
+    uint64_t sig[VM_PHASE_SIG_WORDS];  /* signature of the interval that opened it */
+    int intervals;
+    long long references;
+    long long faults;
+};
+
+struct vm_phase_tracker {
+    int interval;           /* references per interval */
+    double threshold;       /* Jaccard distance that separates phases */
+
+    uint64_t sig[VM_PHASE_SIG_WORDS];  /* interval in progress */
+    int fill;
+    long long faults;
+
+    struct vm_phase *phases;
+    int nphases;
+    int phase_cap;
+    int current;            /* -1 before the first interval closes */
+
+    int *timeline;          /* phase of every closed interval */
+    int ntimeline;
+    int timeline_cap;
+};
+
+int vm_phase_init(struct vm_phase_tracker *pt, int interval, double threshold);
+void vm_phase_free(struct vm_phase_tracker *pt);
+
+/* Fill obs so that a run feeds pt */
+void vm_phase_observer(struct vm_phase_tracker *pt, struct vm_observer *obs);
+
+/* Feed one reference directly; 0, or -1 if out of memory */
+int vm_phase_access(struct vm_phase_tracker *pt, int page, int fault);
+
+/* Close a partial last interval; 0 or -1 */
+int vm_phase_finish(struct vm_phase_tracker *pt);
+
+/* Jaccard distance between two signatures, 0 for two empty ones */
+double vm_phase_distance(const uint64_t *a, const uint64_t *b);
+
+#endif /* PHASE_H */
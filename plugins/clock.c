@@ -0,0 +1,115 @@
+/*
+ * clock.c
+ *
+ * Example out-of-tree policy: CLOCK (second chance). Build as a shared object
+ * and load it with vm_plugin_load():
+ *
+ *     cc -shared -fPIC -I.. -o clock.so clock.c
+ *
+ * The hand sweeps the page table; a referenced page gets its bit cleared and
+ * is skipped once, an unreferenced one is the victim. The compact state packs
+ * the reference bits eight to a byte.
+ */
+
+#include <stdlib.h>
+
+#include "vm_policy.h"
+
+struct clock_state {
+    int hand;
+    int packed;
+    unsigned char *ref;
+};
+
+static size_t clock_ref_bytes(int table_cnt, int compact) {
+    size_t n = table_cnt > 0 ? (size_t)table_cnt : 1;
+    return compact ? (n + 7) / 8 : n;
+}
+
+static size_t clock_state_bytes(int table_cnt, int frame_cnt, int compact) {
+    (void)frame_cnt;
+    return sizeof(struct clock_state) + clock_ref_bytes(table_cnt, compact);
+}
+
+static void *clock_create_packed(int table_cnt, int packed) {
+    struct clock_state *st = malloc(sizeof(*st));
+    if (!st) return NULL;
+    st->hand = 0;
+    st->packed = packed;
+    st->ref = calloc(clock_ref_bytes(table_cnt, packed), 1);
+    if (!st->ref) {
+        free(st);
+        return NULL;
+    }
+    return st;
+}
+
+static void *clock_create(int table_cnt, int frame_cnt) {
+    (void)frame_cnt;
+    return clock_create_packed(table_cnt, 0);
+}
+
+static void *clock_create_compact(int table_cnt, int frame_cnt) {
+    (void)frame_cnt;
+    return clock_create_packed(table_cnt, 1);
+}
+
+static void clock_destroy(void *state) {
+    struct clock_state *st = state;
+    free(st->ref);
+    free(st);
+}
+
+static int ref_get(const struct clock_state *st, int page) {
+    return st->packed ? (st->ref[page / 8] >> (page % 8)) & 1 : st->ref[page];
+}
+
+static void ref_set(struct clock_state *st, int page, int bit) {
+    if (!st->packed) {
+        st->ref[page] = (unsigned char)bit;
+    } else if (bit) {
+        st->ref[page / 8] |= (unsigned char)(1u << (page % 8));
+    } else {
+        st->ref[page / 8] &= (unsigned char)~(1u << (page % 8));
+    }
+}
+
+static void clock_touch(void *state, struct PTE *page_table, int page, int timestamp) {
+    struct clock_state *st = state;
+    (void)page_table; (void)timestamp;
+    ref_set(st, page, 1);
+}
+
+static int clock_choose(void *state, struct PTE *page_table, int table_cnt, int timestamp) {
+    struct clock_state *st = state;
+    (void)timestamp;
+    /* two full sweeps are enough: the first clears every reference bit */
+    for (int n = 0; n < 2 * table_cnt; ++n) {
+        int p = st->hand;
+        st->hand = (st->hand + 1) % table_cnt;
+        if (!page_table[p].is_valid) continue;
+        if (ref_get(st, p)) {
+            ref_set(st, p, 0);
+            continue;
+        }
+        return p;
+    }
+    return -1;
+}
+
+static void clock_on_evict(void *state, struct PTE *page_table, int page, int timestamp) {
+    struct clock_state *st = state;
+    (void)page_table; (void)timestamp;
+    ref_set(st, page, 0);
+}
+
+static const struct vm_policy_ops clock_ops = {
+    VM_POLICY_ABI_VERSION, "clock",
+    clock_create, clock_destroy,
+    clock_touch, clock_touch, clock_choose, clock_on_evict,
+    clock_state_bytes, clock_create_compact
+};
+
+const struct vm_policy_ops *vm_policy_entry(void) {
+    return &clock_ops;
+}
@@ -0,0 +1,15 @@
+from setuptools import Extension, setup
+
+setup(
+    name="vmsim",
+    version="0.1",
+    ext_modules=[
+        Extension(
+            "vmsim",
+            sources=["vmsimmodule.c", "../virtual.c", "../vm_engine.c", "../vm_simd.c",
+                     "../stackdist.c"],
+            include_dirs=[".."],
+            libraries=["dl"],
+        )
+    ],
+)
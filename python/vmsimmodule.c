@@ -0,0 +1,263 @@
+/*
+ * vmsimmodule.c
+ *
+ * CPython bindings for the counting engines.
+ *
+ *     vmsim.count_page_faults(refs, frames, policy="lru", table_size=None)
+ *     vmsim.miss_ratio_curve(refs, max_frames, policy="lru", table_size=None)
+ *
+ * refs is any C-contiguous buffer of signed 32- or 64-bit integers (NumPy
+ * int32/int64 arrays, array.array, ...). int32 buffers are handed to the engine
+ * without copying; int64 buffers are narrowed into a temporary int array. The
+ * GIL is released for the whole simulation, so sweeps driven from several
+ * Python threads run in parallel.
+ *
+ * Stack algorithms (policy "lru", and "opt", which has no replay engine) are
+ * swept from a single stack-distance pass instead of one replay per frame count.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "oslabs.h"
+#include "vm_engine.h"
+#include "stackdist.h"
+
+/* Reference string borrowed from (or converted out of) a Python buffer */
+struct refs_view {
+    Py_buffer view;
+    int *refs;
+    int owned;      /* refs was allocated for int64 input */
+    int count;
+};
+
+static int format_is(const char *fmt, const char *codes) {
+    if (!fmt) return strchr(codes, 'B') != NULL;
+    if (*fmt == '@' || *fmt == '=' || *fmt == '<' || *fmt == '>' || *fmt == '!') fmt++;
+    return fmt[0] && !fmt[1] && strchr(codes, fmt[0]) != NULL;
+}
+
+static void refs_release(struct refs_view *rv) {
+    if (rv->owned) free(rv->refs);
+    PyBuffer_Release(&rv->view);
+}
+
+static int refs_acquire(PyObject *obj, struct refs_view *rv) {
+    memset(rv, 0, sizeof(*rv));
+    if (PyObject_GetBuffer(obj, &rv->view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) return -1;
+
+    Py_ssize_t n = rv->view.itemsize ? rv->view.len / rv->view.itemsize : 0;
+    if (n > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError, "reference string too long");
+        goto fail;
+    }
+    rv->count = (int)n;
+
+    if (rv->view.itemsize == (Py_ssize_t)sizeof(int) && format_is(rv->view.format, "il")) {
+        rv->refs = rv->view.buf;  /* zero-copy; the engines never write refs */
+        return 0;
+    }
+    if (rv->view.itemsize == 8 && format_is(rv->view.format, "qln")) {
+        const long long *src = rv->view.buf;
+        int bad = 0;
+        rv->refs = malloc(sizeof(int) * (size_t)(n > 0 ? n : 1));
+        if (!rv->refs) {
+            PyErr_NoMemory();
+            goto fail;
+        }
+        rv->owned = 1;
+        Py_BEGIN_ALLOW_THREADS
+        for (Py_ssize_t i = 0; i < n; ++i) {
+            if (src[i] < INT_MIN || src[i] > INT_MAX) bad = 1;
+            rv->refs[i] = (int)src[i];
+        }
+        Py_END_ALLOW_THREADS
+        if (bad) {
+            PyErr_SetString(PyExc_OverflowError, "page number does not fit in a C int");
+            goto fail;
+        }
+        return 0;
+    }
+    PyErr_SetString(PyExc_TypeError, "refs must be a contiguous int32 or int64 buffer");
+fail:
+    refs_release(rv);
+    return -1;
+}
+
+/* Largest page + 1, or -1 if a page number is negative */
+static int table_size_for(const int *refs, int n) {
+    int max = -1;
+    for (int i = 0; i < n; ++i) {
+        if (refs[i] < 0) return -1;
+        if (refs[i] > max) max = refs[i];
+    }
+    return max + 1;
+}
+
+/* 0 if every page is below table_cnt, or -1 */
+static int refs_in_table(const int *refs, int n, int table_cnt) {
+    for (int i = 0; i < n; ++i)
+        if (refs[i] < 0 || refs[i] >= table_cnt) return -1;
+    return 0;
+}
+
+/* One run on a fresh page table; returns the fault count or -1 */
+static int run_once(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                    int *frame_pool, int *refs, int n, int frames) {
+    memset(page_table, 0, sizeof(struct PTE) * (size_t)table_cnt);
+    for (int f = 0; f < frames; ++f) frame_pool[f] = f;
+    return vm_policy_run(ops, page_table, table_cnt, refs, n, frame_pool, frames);
+}
+
+static const struct vm_policy_ops *policy_arg(const char *name) {
+    const struct vm_policy_ops *ops = vm_policy_find(name);
+    if (!ops) PyErr_Format(PyExc_ValueError, "unknown policy '%s'", name);
+    return ops;
+}
+
+/* Sweep frames lo..hi (inclusive) into faults[]; returns 0 or -1 on allocation failure */
+static int sweep(const struct vm_policy_ops *ops, int *refs, int n, int table_cnt,
+                 int lo, int hi, long *faults) {
+    struct PTE *page_table = malloc(sizeof(struct PTE) * (size_t)(table_cnt > 0 ? table_cnt : 1));
+    int *frame_pool = malloc(sizeof(int) * (size_t)(hi > 0 ? hi : 1));
+    int rc = 0;
+    if (!page_table || !frame_pool) {
+        rc = -1;
+    } else {
+        for (int f = lo; f <= hi; ++f) {
+            faults[f - lo] = run_once(ops, page_table, table_cnt, frame_pool, refs, n, f);
+            if (faults[f - lo] < 0) {
+                rc = -1;
+                break;
+            }
+        }
+    }
+    free(page_table);
+    free(frame_pool);
+    return rc;
+}
+
+/* Same as sweep() from one stack-distance profile */
+static int stack_sweep(enum vm_stack_kind kind, int *refs, int n, int table_cnt,
+                       int lo, int hi, long *faults) {
+    struct vm_stack_profile sp;
+    if (vm_stack_profile_build(&sp, kind, refs, n, table_cnt) < 0) return -1;
+    for (int f = lo; f <= hi; ++f) faults[f - lo] = (long)vm_stack_faults(&sp, f);
+    vm_stack_profile_free(&sp);
+    return 0;
+}
+
+static PyObject *run_sweep(PyObject *refs_obj, const char *policy, Py_ssize_t table_arg,
+                           int lo, int hi) {
+    /* a single lru count is cheaper as a plain replay */
+    int kind = vm_stack_kind(policy);
+    if (kind == VM_STACK_LRU && lo == hi) kind = -1;
+    const struct vm_policy_ops *ops = NULL;
+    if (kind < 0 && !(ops = policy_arg(policy))) return NULL;
+    if (lo < 0 || hi < lo) {
+        PyErr_SetString(PyExc_ValueError, "frame count must be non-negative");
+        return NULL;
+    }
+    if (table_arg > INT_MAX) {
+        PyErr_SetString(PyExc_ValueError, "table_size does not fit in a C int");
+        return NULL;
+    }
+    struct refs_view rv;
+    if (refs_acquire(refs_obj, &rv) < 0) return NULL;
+
+    long *faults = malloc(sizeof(long) * (size_t)(hi - lo + 1));
+    if (!faults) {
+        refs_release(&rv);
+        return PyErr_NoMemory();
+    }
+    int table_cnt = (int)table_arg;
+    int rc;
+    Py_BEGIN_ALLOW_THREADS
+    if (table_arg < 0) table_cnt = table_size_for(rv.refs, rv.count);
+    if (table_cnt < 0)
+        rc = -2;
+    else if (table_arg >= 0 && refs_in_table(rv.refs, rv.count, table_cnt) < 0)
+        rc = -3;
+    else if (kind >= 0)
+        rc = stack_sweep(kind, rv.refs, rv.count, table_cnt, lo, hi, faults);
+    else
+        rc = sweep(ops, rv.refs, rv.count, table_cnt, lo, hi, faults);
+    Py_END_ALLOW_THREADS
+    refs_release(&rv);
+
+    PyObject *result = NULL;
+    if (rc == -2) {
+        PyErr_SetString(PyExc_ValueError, "negative page number in refs");
+    } else if (rc == -3) {
+        PyErr_SetString(PyExc_ValueError, "page number in refs outside table_size");
+    } else if (rc < 0) {
+        PyErr_NoMemory();
+    } else if (lo == hi) {
+        result = PyLong_FromLong(faults[0]);
+    } else if ((result = PyList_New(hi - lo + 1)) != NULL) {
+        for (int f = lo; f <= hi; ++f) {
+            PyObject *v = PyLong_FromLong(faults[f - lo]);
+            if (!v) {
+                Py_CLEAR(result);
+                break;
+            }
+            PyList_SET_ITEM(result, f - lo, v);
+        }
+    }
+    free(faults);
+    return result;
+}
+
+static PyObject *vmsim_count_page_faults(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"refs", "frames", "policy", "table_size", NULL};
+    PyObject *refs;
+    int frames;
+    const char *policy = "lru";
+    Py_ssize_t table_size = -1;
+    (void)self;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oi|sn", kwlist,
+                                     &refs, &frames, &policy, &table_size))
+        return NULL;
+    return run_sweep(refs, policy, table_size, frames, frames);
+}
+
+static PyObject *vmsim_miss_ratio_curve(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"refs", "max_frames", "policy", "table_size", NULL};
+    PyObject *refs;
+    int max_frames;
+    const char *policy = "lru";
+    Py_ssize_t table_size = -1;
+    (void)self;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oi|sn", kwlist,
+                                     &refs, &max_frames, &policy, &table_size))
+        return NULL;
+    if (max_frames < 1) {
+        PyErr_SetString(PyExc_ValueError, "max_frames must be at least 1");
+        return NULL;
+    }
+    return run_sweep(refs, policy, table_size, 1, max_frames);
+}
+
+static PyMethodDef vmsim_methods[] = {
+    {"count_page_faults", (PyCFunction)(void (*)(void))vmsim_count_page_faults,
+     METH_VARARGS | METH_KEYWORDS,
+     "count_page_faults(refs, frames, policy='lru', table_size=None) -> int"},
+    {"miss_ratio_curve", (PyCFunction)(void (*)(void))vmsim_miss_ratio_curve,
+     METH_VARARGS | METH_KEYWORDS,
+     "miss_ratio_curve(refs, max_frames, policy='lru', table_size=None) -> list\n"
+     "Fault counts for 1..max_frames frames."},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef vmsim_module = {
+    PyModuleDef_HEAD_INIT, "vmsim", "Page replacement simulator.", -1, vmsim_methods,
+    NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_vmsim(void) {
+    return PyModule_Create(&vmsim_module);
+}
@@ -0,0 +1,152 @@
+/*
+ * stackdist.c
+ *
+ * LRU distances come from a Fenwick tree over reference positions holding a
+ * mark at each page's latest reference: the depth of a reuse is the number of
+ * marks after the page's previous reference, plus one. O(n log n).
+ *
+ * OPT uses Mattson's priority stack: after the referenced page moves to the
+ * top, each level down to its old slot keeps whichever of (carried page, page
+ * at that level) is referenced sooner and carries the other on. O(n * depth).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "stackdist.h"
+
+int vm_stack_kind(const char *name) {
+    if (strcmp(name, "lru") == 0) return VM_STACK_LRU;
+    if (strcmp(name, "opt") == 0) return VM_STACK_OPT;
+    return -1;
+}
+
+/* ---------------- LRU ---------------- */
+
+static void fenwick_add(int *tree, int n, int i, int v) {
+    for (; i <= n; i += i & -i) tree[i] += v;
+}
+
+static int fenwick_sum(const int *tree, int i) {
+    int s = 0;
+    for (; i > 0; i -= i & -i) s += tree[i];
+    return s;
+}
+
+/* hist[d] for 1 <= d <= table_cnt; cold and invalid references are left out */
+static int lru_depths(const int *refs, int n, int table_cnt, long long *hist) {
+    int *tree = calloc((size_t)n + 1, sizeof(int));
+    int *last = calloc(table_cnt > 0 ? (size_t)table_cnt : 1, sizeof(int));
+    if (!tree || !last) {
+        free(tree);
+        free(last);
+        return -1;
+    }
+    for (int i = 1; i <= n; ++i) {
+        int p = refs[i - 1];
+        if (p < 0 || p >= table_cnt) continue;
+        if (last[p]) {
+            hist[fenwick_sum(tree, i - 1) - fenwick_sum(tree, last[p]) + 1]++;
+            fenwick_add(tree, n, last[p], -1);
+        }
+        fenwick_add(tree, n, i, 1);
+        last[p] = i;
+    }
+    free(tree);
+    free(last);
+    return 0;
+}
+
+/* ---------------- OPT ---------------- */
+
+static int opt_depths(const int *refs, int n, int table_cnt, long long *hist) {
+    size_t tc = table_cnt > 0 ? (size_t)table_cnt : 1;
+    int *next = malloc(sizeof(int) * ((size_t)n + 1));   /* next use of the page at i */
+    int *seen = malloc(sizeof(int) * tc);
+    int *next_use = malloc(sizeof(int) * tc);            /* per resident page */
+    int *stack = malloc(sizeof(int) * tc);
+    int rc = -1;
+    if (!next || !seen || !next_use || !stack) goto done;
+
+    for (size_t p = 0; p < tc; ++p) seen[p] = n;          /* n: never again */
+    for (int i = n - 1; i >= 0; --i) {
+        int p = refs[i];
+        if (p < 0 || p >= table_cnt) continue;
+        next[i] = seen[p];
+        seen[p] = i;
+    }
+
+    int depth_max = 0;
+    for (int i = 0; i < n; ++i) {
+        int p = refs[i];
+        if (p < 0 || p >= table_cnt) continue;
+        int d = 0;
+        while (d < depth_max && stack[d] != p) d++;
+        if (d < depth_max) hist[d + 1]++;
+        else depth_max++;                                 /* cold: a new bottom slot */
+        next_use[p] = next[i];
+
+        if (d > 0) {
+            int carry = stack[0];
+            for (int k = 1; k < d; ++k) {
+                if (next_use[stack[k]] > next_use[carry]) {
+                    int t = stack[k];
+                    stack[k] = carry;
+                    carry = t;
+                }
+            }
+            stack[d] = carry;
+        }
+        stack[0] = p;
+    }
+    rc = 0;
+
+done:
+    free(next);
+    free(seen);
+    free(next_use);
+    free(stack);
+    return rc;
+}
+
+/* ---------------- profile ---------------- */
+
+int vm_stack_profile_build(struct vm_stack_profile *sp, enum vm_stack_kind kind,
+                           const int *refs, int reference_cnt, int table_cnt) {
+    memset(sp, 0, sizeof(*sp));
+    sp->kind = kind;
+    sp->reference_cnt = reference_cnt;
+    size_t depths = (table_cnt > 0 ? (size_t)table_cnt : 0) + 1;
+    long long *hist = calloc(depths, sizeof(long long));
+    if (!hist) return -1;
+    int rc = kind == VM_STACK_LRU ? lru_depths(refs, reference_cnt, table_cnt, hist)
+                                  : opt_depths(refs, reference_cnt, table_cnt, hist);
+    if (rc < 0) {
+        free(hist);
+        return -1;
+    }
+
+    /* every reference not found within f frames faults; reuses at depth d hit
+     * once f >= d, so faults_above[f] = n - sum(hist[1..f]) */
+    int max_depth = 0;
+    for (size_t d = 1; d < depths; ++d)
+        if (hist[d]) max_depth = (int)d;
+    sp->max_depth = max_depth;
+    sp->faults_above = hist;   /* reused in place: hist[0] is always 0 */
+    long long faults = reference_cnt;
+    for (int f = 0; f <= max_depth; ++f) {
+        faults -= hist[f];
+        sp->faults_above[f] = faults;
+    }
+    return 0;
+}
+
+void vm_stack_profile_free(struct vm_stack_profile *sp) {
+    free(sp->faults_above);
+    sp->faults_above = NULL;
+}
+
+long long vm_stack_faults(const struct vm_stack_profile *sp, int frames) {
+    if (frames < 0) frames = 0;
+    return sp->faults_above[frames < sp->max_depth ? frames : sp->max_depth];
+}
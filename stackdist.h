@@ -0,0 +1,39 @@
+/*
+ * stackdist.h
+ *
+ * Stack-distance profiles for stack algorithms (LRU, OPT). One pass over a
+ * trace records the depth at which every reference finds its page; by the
+ * inclusion property the fault count for any frame count is then a suffix sum
+ * of that histogram, so sweeps over frame_cnt need no replay. Profiles assume
+ * a fresh page table (nothing valid on entry), as vmsim and sweeps use.
+ *
+ * FIFO, LFU, MRU as implemented here, random and CLOCK are not covered: their
+ * resident sets are not nested across frame counts (FIFO shows Belady's
+ * anomaly), so every frame count needs its own replay.
+ */
+
+#ifndef STACKDIST_H
+#define STACKDIST_H
+
+enum vm_stack_kind { VM_STACK_LRU, VM_STACK_OPT };
+
+struct vm_stack_profile {
+    enum vm_stack_kind kind;
+    int reference_cnt;
+    int max_depth;              /* deepest reuse seen */
+    long long *faults_above;    /* faults_above[f], f = 0..max_depth: faults with f frames */
+};
+
+/* Kind for a policy name ("lru", "opt"), or -1 if a full replay is required */
+int vm_stack_kind(const char *name);
+
+/* One pass over refs; references outside [0, table_cnt) always fault.
+ * Returns 0 or -1 if out of memory. */
+int vm_stack_profile_build(struct vm_stack_profile *sp, enum vm_stack_kind kind,
+                           const int *refs, int reference_cnt, int table_cnt);
+void vm_stack_profile_free(struct vm_stack_profile *sp);
+
+/* Faults with frames frames, O(1) */
+long long vm_stack_faults(const struct vm_stack_profile *sp, int frames);
+
+#endif /* STACKDIST_H */
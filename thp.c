@@ -0,0 +1,362 @@
+/*
+ * thp.c
+ *
+ * A unit is named by the first frame of its block: the replacement list is
+ * linked through per-frame arrays, and owner[] maps every frame back to its
+ * page, so eviction never walks the page table.
+ *
+ * Compaction works like the kernel's paired scanners folded into one step:
+ * pick the aligned block that is cheapest to clear, then take destination
+ * frames from the allocator, skipping any that fall inside that block.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "thp.h"
+
+struct thp {
+    struct vm_buddy b;
+    struct PTE *pt;
+    int table_cnt;
+    int huge_order;
+    int compact;                /* enum vm_compact_mode */
+    int nregions;               /* whole regions inside the table */
+    int *owner;                 /* page per frame, -1 if free */
+    signed char *unit_order;    /* per unit head frame */
+    int *next, *prev;           /* replacement list, head newest */
+    int head, tail;
+    unsigned char *region_huge;
+    int *region_resident;       /* base pages resident per region */
+    struct vm_thp_stats *st;
+};
+
+static void unit_link(struct thp *t, int f) {
+    t->prev[f] = -1;
+    t->next[f] = t->head;
+    if (t->head >= 0) t->prev[t->head] = f;
+    t->head = f;
+    if (t->tail < 0) t->tail = f;
+}
+
+static void unit_unlink(struct thp *t, int f) {
+    if (t->prev[f] >= 0) t->next[t->prev[f]] = t->next[f];
+    else t->head = t->next[f];
+    if (t->next[f] >= 0) t->prev[t->next[f]] = t->prev[f];
+    else t->tail = t->prev[f];
+}
+
+static void unit_link_tail(struct thp *t, int f) {
+    t->next[f] = -1;
+    t->prev[f] = t->tail;
+    if (t->tail >= 0) t->next[t->tail] = f;
+    t->tail = f;
+    if (t->head < 0) t->head = f;
+}
+
+static void map_page(struct thp *t, int page, int frame, int timestamp) {
+    struct PTE *p = &t->pt[page];
+    p->is_valid = 1;
+    p->frame_number = frame;
+    p->arrival_timestamp = timestamp;
+    p->last_access_timestamp = timestamp;
+    p->reference_count = 1;
+    t->owner[frame] = page;
+}
+
+/* Evict a base page unit */
+static void evict_unit(struct thp *t, int head) {
+    int page = t->owner[head];
+    int region = t->huge_order > 0 ? page >> t->huge_order : -1;
+    if (region >= 0 && region < t->nregions) t->region_resident[region]--;
+    struct PTE *p = &t->pt[page];
+    p->is_valid = 0;
+    p->frame_number = -1;
+    p->arrival_timestamp = 0;
+    p->last_access_timestamp = 0;
+    p->reference_count = 0;
+    t->owner[head] = -1;
+    unit_unlink(t, head);
+    t->st->evictions++;
+    vm_buddy_release(&t->b, head, 0);
+}
+
+/* Evict the oldest unit. A huge mapping is split first, as reclaim does,
+ * and only its first page goes: the rest stay resident as base pages at the
+ * old end of the list. */
+static void reclaim_one(struct thp *t) {
+    int head = t->tail;
+    int order = t->unit_order[head];
+    if (order) {
+        int region = t->owner[head] >> t->huge_order;
+        t->region_huge[region] = 0;
+        unit_unlink(t, head);
+        for (int k = (1 << order) - 1; k >= 0; --k) {
+            t->unit_order[head + k] = 0;
+            unit_link_tail(t, head + k);
+        }
+        t->st->huge_splits++;
+    }
+    evict_unit(t, t->tail);
+}
+
+static void thp_free(struct thp *t) {
+    vm_buddy_free_all(&t->b);
+    free(t->owner);
+    free(t->unit_order);
+    free(t->next);
+    free(t->prev);
+    free(t->region_huge);
+    free(t->region_resident);
+}
+
+static int thp_init(struct thp *t, struct PTE *page_table, int table_cnt, int frame_cnt,
+                    const struct vm_thp_params *p, struct vm_thp_stats *st) {
+    memset(t, 0, sizeof(*t));
+    t->pt = page_table;
+    t->table_cnt = table_cnt;
+    t->huge_order = p->huge_order;
+    t->compact = p->huge_order > 0 ? p->compact : VM_COMPACT_NONE;
+    t->nregions = p->huge_order > 0 ? table_cnt >> p->huge_order : 0;
+    t->head = t->tail = -1;
+    t->st = st;
+    size_t n = (size_t)(frame_cnt > 0 ? frame_cnt : 1);
+    size_t r = (size_t)(t->nregions > 0 ? t->nregions : 1);
+    t->owner = malloc(sizeof(int) * n);
+    t->unit_order = malloc(n);
+    t->next = malloc(sizeof(int) * n);
+    t->prev = malloc(sizeof(int) * n);
+    t->region_huge = calloc(r, 1);
+    t->region_resident = calloc(r, sizeof(int));
+    if (vm_buddy_init(&t->b, frame_cnt, p->huge_order > 0 ? p->huge_order : 0) < 0 ||
+        !t->owner || !t->unit_order || !t->next || !t->prev || !t->region_huge ||
+        !t->region_resident) {
+        thp_free(t);
+        return -1;
+    }
+    for (int f = 0; f < frame_cnt; ++f) t->owner[f] = -1;
+    return 0;
+}
+
+/* First frame of the unit holding a resident page */
+static int unit_of(const struct thp *t, int page) {
+    int region = t->huge_order > 0 ? page >> t->huge_order : -1;
+    if (region >= 0 && region < t->nregions && t->region_huge[region])
+        return t->pt[page].frame_number - (page & ((1 << t->huge_order) - 1));
+    return t->pt[page].frame_number;
+}
+
+/* ---------------- consistency ---------------- */
+
+/* 0 if the allocator, owner map, page table and replacement list agree */
+static int consistent(const struct thp *t) {
+    const struct vm_buddy *b = &t->b;
+    int idle = 0, listed = 0;
+    for (int f = 0; f < b->nframes; ++f) {
+        if (!b->busy[f]) {
+            idle++;
+            if (t->owner[f] >= 0) return -1;
+            continue;
+        }
+        int page = t->owner[f];
+        if (page < 0 || page >= t->table_cnt || !t->pt[page].is_valid ||
+            t->pt[page].frame_number != f)
+            return -1;
+    }
+    if (idle != b->free_frames) return -1;
+    for (int o = 0; o <= b->max_order; ++o) {
+        int blocks = 0;
+        for (int f = b->head[o]; f >= 0; f = b->next[f]) {
+            if (++blocks > b->nframes || (f & ((1 << o) - 1)) || f + (1 << o) > b->nframes ||
+                b->free_order[f] != o)
+                return -1;
+            for (int k = 0; k < 1 << o; ++k)
+                if (b->busy[f + k]) return -1;
+            listed += 1 << o;
+        }
+        if (blocks != b->nfree[o]) return -1;
+    }
+    if (listed != b->free_frames) return -1;
+    for (int page = 0; page < t->table_cnt; ++page) {
+        const struct PTE *p = &t->pt[page];
+        if (p->is_valid && (p->frame_number < 0 || p->frame_number >= b->nframes ||
+                            !b->busy[p->frame_number] || t->owner[p->frame_number] != page))
+            return -1;
+    }
+    /* the units on the replacement list cover every busy frame once */
+    int covered = 0, prev = -1;
+    for (int u = t->head; u >= 0; u = t->next[u]) {
+        if (t->prev[u] != prev || covered > b->nframes || !b->busy[u]) return -1;
+        covered += 1 << t->unit_order[u];
+        prev = u;
+    }
+    if (prev != t->tail || covered != b->nframes - b->free_frames) return -1;
+    return 0;
+}
+
+/* ---------------- compaction ---------------- */
+
+static int movable(const struct thp *t, int frame) {
+    int page = t->owner[frame];
+    if (page < 0) return 0;
+    int region = page >> t->huge_order;
+    return region >= t->nregions || !t->region_huge[region];
+}
+
+/* Aligned huge block holding the fewest base pages and nothing unmovable;
+ * -1 if every block holds part of a huge mapping */
+static int compact_target(const struct thp *t, int *cost) {
+    int size = 1 << t->huge_order, best = -1;
+    for (int start = 0; start + size <= t->b.nframes; start += size) {
+        int used = 0, pinned = 0;
+        for (int f = start; f < start + size && !pinned; ++f) {
+            if (!t->b.busy[f]) continue;
+            if (!movable(t, f)) pinned = 1;
+            used++;
+        }
+        if (pinned || (best >= 0 && used >= *cost)) continue;
+        best = start;
+        *cost = used;
+        if (!used) break;
+    }
+    return best;
+}
+
+/* Move the base page in frame from to frame to, keeping its list position */
+static void migrate(struct thp *t, int from, int to) {
+    int page = t->owner[from];
+    t->pt[page].frame_number = to;
+    t->owner[to] = page;
+    t->owner[from] = -1;
+    t->unit_order[to] = 0;
+    t->prev[to] = t->prev[from];
+    t->next[to] = t->next[from];
+    if (t->prev[to] >= 0) t->next[t->prev[to]] = to;
+    else t->head = to;
+    if (t->next[to] >= 0) t->prev[t->next[to]] = to;
+    else t->tail = to;
+    vm_buddy_release(&t->b, from, 0);
+    t->st->pages_migrated++;
+}
+
+/* Empty one aligned huge block; 0, or -1 if no block can be emptied */
+static int compact(struct thp *t) {
+    int size = 1 << t->huge_order, cost = 0;
+    t->st->compact_runs++;
+    int target = compact_target(t, &cost);
+    if (target < 0 || t->b.free_frames - (size - cost) < cost) {
+        t->st->compact_fail++;
+        return -1;
+    }
+    int held[1 << VM_BUDDY_MAX_ORDER];
+    int nheld = 0;
+    for (int f = target; f < target + size; ++f) {
+        if (t->owner[f] < 0) continue;
+        int to;
+        /* free frames inside the target are set aside until it is clear */
+        while ((to = vm_buddy_alloc(&t->b, 0)) >= target && to < target + size)
+            held[nheld++] = to;
+        migrate(t, f, to);
+    }
+    for (int k = 0; k < nheld; ++k) vm_buddy_release(&t->b, held[k], 0);
+    return 0;
+}
+
+/* Keep one huge block ready: reclaim for it the way kswapd does for a
+ * high-order wakeup, then compact as kcompactd would */
+static void background_compact(struct thp *t) {
+    int size = 1 << t->huge_order;
+    if (t->b.nfree[t->huge_order] || t->b.nframes < size) return;
+    while (t->b.free_frames < size && t->tail >= 0) reclaim_one(t);
+    if (t->b.free_frames >= size && vm_buddy_largest(&t->b) < t->huge_order) compact(t);
+}
+
+/* Map the whole region of page with one huge block; 0, or -1 to fall back */
+static int fault_huge(struct thp *t, int page, int timestamp) {
+    int region = page >> t->huge_order;
+    int size = 1 << t->huge_order;
+    /* a block that can never exist is not worth reclaiming for */
+    if (region >= t->nregions || t->region_resident[region] || t->b.nframes < size) return -1;
+    /* direct reclaim: free a huge page's worth of frames, wherever they are */
+    while (t->b.free_frames < size && t->tail >= 0) reclaim_one(t);
+    int blk = vm_buddy_alloc(&t->b, t->huge_order);
+    if (blk < 0 && t->compact == VM_COMPACT_DIRECT && t->b.free_frames >= size &&
+        compact(t) == 0)
+        blk = vm_buddy_alloc(&t->b, t->huge_order);
+    if (blk < 0) {
+        if (t->b.free_frames >= size) {
+            t->st->fallback_frag++;
+            t->st->unusable_sum += vm_buddy_unusable(&t->b, t->huge_order);
+            int cost = vm_buddy_compact_cost(&t->b, t->huge_order);
+            if (cost > 0) t->st->compact_cost += cost;
+        } else {
+            t->st->fallback_nomem++;
+        }
+        return -1;
+    }
+    int base = region << t->huge_order;
+    for (int k = 0; k < size; ++k) map_page(t, base + k, blk + k, timestamp);
+    t->region_huge[region] = 1;
+    t->region_resident[region] = size;
+    t->unit_order[blk] = (signed char)t->huge_order;
+    unit_link(t, blk);
+    t->st->huge_faults++;
+    return 0;
+}
+
+int vm_thp_run(struct PTE *page_table, int table_cnt, const int *refs, int reference_cnt,
+               int frame_cnt, const struct vm_thp_params *p, struct vm_thp_stats *stats) {
+    struct thp t;
+    memset(stats, 0, sizeof(*stats));
+    if (table_cnt <= 0) return 0;
+    if (thp_init(&t, page_table, table_cnt, frame_cnt, p, stats) < 0) return -1;
+
+    int rc = 0;
+    for (int i = 0; i < reference_cnt; ++i) {
+        int page = refs[i];
+        int timestamp = i + 1;
+
+        if (p->check && consistent(&t) < 0) {
+            rc = -1;
+            break;
+        }
+        if (t.compact == VM_COMPACT_BACKGROUND && p->compact_interval > 0 &&
+            i % p->compact_interval == 0)
+            background_compact(&t);
+        if (page < 0 || page >= table_cnt) {
+            stats->faults++;
+            continue;
+        }
+        struct PTE *pte = &page_table[page];
+        int region = t.huge_order > 0 ? page >> t.huge_order : -1;
+        if (pte->is_valid) {
+            pte->last_access_timestamp = timestamp;
+            pte->reference_count += 1;
+            if (region >= 0 && region < t.nregions && t.region_huge[region]) stats->huge_refs++;
+            if (p->lru) {
+                int u = unit_of(&t, page);
+                if (t.head != u) {
+                    unit_unlink(&t, u);
+                    unit_link(&t, u);
+                }
+            }
+            continue;
+        }
+
+        stats->faults++;
+        if (t.huge_order > 0 && fault_huge(&t, page, timestamp) == 0) {
+            stats->huge_refs++;
+            continue;
+        }
+        int f;
+        while ((f = vm_buddy_alloc(&t.b, 0)) < 0 && t.tail >= 0) reclaim_one(&t);
+        if (f < 0) continue;
+        map_page(&t, page, f, timestamp);
+        t.unit_order[f] = 0;
+        unit_link(&t, f);
+        if (region >= 0 && region < t.nregions) t.region_resident[region]++;
+    }
+    if (p->check && consistent(&t) < 0) rc = -1;
+    thp_free(&t);
+    return rc < 0 ? -1 : (int)stats->faults;
+}
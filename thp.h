@@ -0,0 +1,62 @@
+/*
+ * thp.h
+ *
+ * Transparent huge page simulation on a buddy allocator. The first fault in
+ * an untouched, aligned region of 2^huge_order pages reclaims until that many
+ * frames are free, then tries an order-huge_order block and maps the whole
+ * region with it; when the free frames are too scattered it falls back to a
+ * single frame, as THP does without compaction. Replacement works on
+ * allocation units (a huge mapping or a base page) in FIFO or LRU order;
+ * reclaim splits a huge mapping into base pages and evicts them one by one,
+ * which is what leaves free memory scattered.
+ *
+ * Compaction clears one aligned block for a huge page by migrating the base
+ * pages in it to free frames elsewhere, rewriting their PTEs' frame_number.
+ * Huge mappings are not movable. It runs on demand when a huge fault finds
+ * free memory too scattered, or periodically in the background, where it
+ * first reclaims a huge page's worth of frames if there are not that many.
+ */
+
+#ifndef THP_H
+#define THP_H
+
+#include "oslabs.h"
+#include "buddy.h"
+
+enum vm_compact_mode {
+    VM_COMPACT_NONE,
+    VM_COMPACT_DIRECT,      /* on a fragmented huge fault, before falling back */
+    VM_COMPACT_BACKGROUND,  /* every compact_interval references, kcompactd style */
+};
+
+struct vm_thp_params {
+    int huge_order;     /* 0 disables huge mappings */
+    int lru;            /* 0: FIFO over units, 1: LRU */
+    int compact;        /* enum vm_compact_mode */
+    int compact_interval;
+    int check;          /* verify allocator and mapping invariants at every reference */
+};
+
+struct vm_thp_stats {
+    long long faults;
+    long long huge_faults;      /* faults that mapped a whole region */
+    long long fallback_nomem;   /* huge attempts that could not reclaim enough */
+    long long fallback_frag;    /* ... with enough free frames, but scattered */
+    long long evictions;
+    long long huge_splits;      /* huge mappings split by reclaim */
+    long long huge_refs;        /* references served by a huge mapping */
+    double unusable_sum;        /* vm_buddy_unusable at each fragmented fallback */
+    long long compact_cost;     /* pages compaction would have moved for those */
+    long long compact_runs;
+    long long compact_fail;     /* no block could be cleared of base pages */
+    long long pages_migrated;
+};
+
+/* Replay refs on a fresh page table with frame_cnt frames from a buddy
+ * allocator; frame numbers are block offsets, not frame_pool entries.
+ * Returns the fault count, or -1 if out of memory or, with check set, an
+ * invariant is broken. */
+int vm_thp_run(struct PTE *page_table, int table_cnt, const int *refs, int reference_cnt,
+               int frame_cnt, const struct vm_thp_params *p, struct vm_thp_stats *stats);
+
+#endif /* THP_H */
@@ -15,8 +15,11 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "oslabs.h"
+#include "vm_engine.h"
+#include "vm_simd.h"
 
 /* Pop front frame from frame_pool (shift left). Returns -1 if empty */
 static int pop_frame_front_int(int frame_pool[POOLMAX], int *frame_cnt) {
@@ -97,6 +100,50 @@ static int choose_lfu_victim_pte(struct PTE *page_table, int table_cnt) {
     return victim;
 }
 
+/* Victim choice used by the engines. The min-key pass runs through the
+ * runtime-dispatched vector kernel (vm_simd.c); when several entries share the
+ * minimum, only those are examined for the arrival/frame tie-breaks, which
+ * gives the same victim as the scalar choosers. Without a vector kernel the
+ * scalar chooser runs as is.
+ */
+static int choose_min_key_victim(struct PTE *page_table, int table_cnt, int key_field) {
+    int first, count;
+    int min_key = vm_min_valid_field(page_table, table_cnt, key_field, &first, &count);
+    if (count <= 1) return first;
+
+    int victim = -1;
+    int min_arr = INT_MAX;
+    int min_frame = INT_MAX;
+    for (int i = first; i < table_cnt; ++i) {
+        const int *rec = (const int *)&page_table[i];
+        if (page_table[i].is_valid && rec[key_field] == min_key) {
+            int at = page_table[i].arrival_timestamp;
+            int fn = page_table[i].frame_number;
+            if (victim < 0 || at < min_arr || (at == min_arr && fn < min_frame)) {
+                min_arr = at;
+                min_frame = fn;
+                victim = i;
+            }
+        }
+    }
+    return victim;
+}
+
+static int choose_fifo_victim(struct PTE *page_table, int table_cnt) {
+    if (!vm_simd_enabled()) return choose_fifo_victim_pte(page_table, table_cnt);
+    return choose_min_key_victim(page_table, table_cnt, VM_PTE_FIELD(arrival_timestamp));
+}
+
+static int choose_lru_victim(struct PTE *page_table, int table_cnt) {
+    if (!vm_simd_enabled()) return choose_lru_victim_pte(page_table, table_cnt);
+    return choose_min_key_victim(page_table, table_cnt, VM_PTE_FIELD(last_access_timestamp));
+}
+
+static int choose_lfu_victim(struct PTE *page_table, int table_cnt) {
+    if (!vm_simd_enabled()) return choose_lfu_victim_pte(page_table, table_cnt);
+    return choose_min_key_victim(page_table, table_cnt, VM_PTE_FIELD(reference_count));
+}
+
 /* Invalidate a PTE (used by single-access functions): set fields to -1 */
 static void invalidate_pte_neg1(struct PTE *p) {
     p->is_valid = 0;
@@ -137,7 +184,7 @@ int process_page_access_fifo(struct PTE *page_table, int *table_cnt, int page_nu
         return fn;
     }
 
-    int victim = choose_fifo_victim_pte(page_table, tcnt);
+    int victim = choose_fifo_victim(page_table, tcnt);
     if (victim < 0) return -1;
     int freed = page_table[victim].frame_number;
     invalidate_pte_neg1(&page_table[victim]);
@@ -163,7 +210,11 @@ int count_page_faults_fifo(struct PTE *page_table, int table_cnt,
         int page = refrence_string[i];
         int timestamp = i + 1; /* start at 1 per spec */
 
-        if (page >= 0 && page < table_cnt && page_table[page].is_valid) {
+        if (page < 0 || page >= table_cnt) {
+            faults++;
+            continue;
+        }
+        if (page_table[page].is_valid) {
             /* hit */
             page_table[page].last_access_timestamp = timestamp;
             page_table[page].reference_count += 1;
@@ -178,7 +229,7 @@ int count_page_faults_fifo(struct PTE *page_table, int table_cnt,
                 page_table[page].last_access_timestamp = timestamp;
                 page_table[page].reference_count = 1;
             } else {
-                int victim = choose_fifo_victim_pte(page_table, table_cnt);
+                int victim = choose_fifo_victim(page_table, table_cnt);
                 if (victim >= 0) {
                     int freed = page_table[victim].frame_number;
                     /* per FIFO spec in test doc: set arrival/last/rc to -1 on replacement */
@@ -218,7 +269,7 @@ int process_page_access_lru(struct PTE *page_table, int *table_cnt, int page_num
         return fn;
     }
 
-    int victim = choose_lru_victim_pte(page_table, tcnt);
+    int victim = choose_lru_victim(page_table, tcnt);
     if (victim < 0) return -1;
     int freed = page_table[victim].frame_number;
     invalidate_pte_neg1(&page_table[victim]);
@@ -244,7 +295,11 @@ int count_page_faults_lru(struct PTE *page_table, int table_cnt,
         int page = refrence_string[i];
         int timestamp = i + 1; /* start at 1 per spec */
 
-        if (page >= 0 && page < table_cnt && page_table[page].is_valid) {
+        if (page < 0 || page >= table_cnt) {
+            faults++;
+            continue;
+        }
+        if (page_table[page].is_valid) {
             /* hit */
             page_table[page].last_access_timestamp = timestamp;
             page_table[page].reference_count += 1;
@@ -258,7 +313,7 @@ int count_page_faults_lru(struct PTE *page_table, int table_cnt,
                 page_table[page].last_access_timestamp = timestamp;
                 page_table[page].reference_count = 1;
             } else {
-                int victim = choose_lru_victim_pte(page_table, table_cnt);
+                int victim = choose_lru_victim(page_table, table_cnt);
                 if (victim >= 0) {
                     int freed = page_table[victim].frame_number;
                     /* per LRU counting spec in test doc: zero-out victim fields */
@@ -298,7 +353,7 @@ int process_page_access_lfu(struct PTE *page_table, int *table_cnt, int page_num
         return fn;
     }
 
-    int victim = choose_lfu_victim_pte(page_table, tcnt);
+    int victim = choose_lfu_victim(page_table, tcnt);
     if (victim < 0) return -1;
     int freed = page_table[victim].frame_number;
     invalidate_pte_neg1(&page_table[victim]);
@@ -325,7 +380,11 @@ int count_page_faults_lfu(struct PTE *page_table, int table_cnt,
         int page = refrence_string[i];
         int timestamp = i + 1;
 
-        if (page >= 0 && page < table_cnt && page_table[page].is_valid) {
+        if (page < 0 || page >= table_cnt) {
+            faults++;
+            continue;
+        }
+        if (page_table[page].is_valid) {
             page_table[page].last_access_timestamp = timestamp;
             page_table[page].reference_count += 1;
         } else {
@@ -338,7 +397,7 @@ int count_page_faults_lfu(struct PTE *page_table, int table_cnt,
                 page_table[page].last_access_timestamp = timestamp;
                 page_table[page].reference_count = 1;
             } else {
-                int victim = choose_lfu_victim_pte(page_table, table_cnt);
+                int victim = choose_lfu_victim(page_table, table_cnt);
                 if (victim >= 0) {
                     int freed = page_table[victim].frame_number;
                     /* many LFU test variants expect zeroing; keep zeroing here for safety */
@@ -355,3 +414,429 @@ int count_page_faults_lfu(struct PTE *page_table, int table_cnt,
     }
     return faults;
 }
+
+/* ---------------- Clustered (region) replacement ----------------
+ * Pages are grouped into fixed-size virtual clusters: page p belongs to cluster
+ * p / cluster_size. Replacement is LRU, but the victim's whole cluster is
+ * evicted and written back with a single I/O operation. With read_cluster set,
+ * a fault also reads the non-resident rest of the faulting cluster in the same
+ * I/O (prefetched pages arrive with reference_count = 0).
+ *
+ * Returns the page fault count; *io_ops (if non-NULL) receives the number of
+ * swap I/O operations (one per cluster write-back, one per fault read).
+ * Freed frames go back to the tail of frame_pool, so the array must have room
+ * for frame_cnt plus the number of pages already resident in page_table.
+ * Out-of-range references count as faults and are otherwise ignored. Victim
+ * fields are zeroed like LRU counting.
+ */
+
+/* Push a frame back onto the tail of frame_pool; the caller sized it (see above) */
+static void push_frame_back_int(int frame_pool[POOLMAX], int *frame_cnt, int fn) {
+    frame_pool[*frame_cnt] = fn;
+    (*frame_cnt)++;
+}
+
+/* LRU victim among pages outside skip_cluster; same tie-breaks as choose_lru_victim_pte */
+static int choose_lru_victim_cluster_pte(struct PTE *page_table, int table_cnt,
+                                         int cluster_size, int skip_cluster) {
+    int victim = -1;
+    int min_last = INT_MAX;
+    int min_arr = INT_MAX;
+    int min_frame = INT_MAX;
+    for (int i = 0; i < table_cnt; ++i) {
+        if (page_table[i].is_valid && i / cluster_size != skip_cluster) {
+            int lat = page_table[i].last_access_timestamp;
+            int at = page_table[i].arrival_timestamp;
+            int fn = page_table[i].frame_number;
+            if (lat < min_last ||
+                (lat == min_last && at < min_arr) ||
+                (lat == min_last && at == min_arr && fn < min_frame)) {
+                min_last = lat;
+                min_arr = at;
+                min_frame = fn;
+                victim = i;
+            }
+        }
+    }
+    return victim;
+}
+
+/* Evict every resident page of a cluster, returning its frames to the pool */
+static void evict_cluster(struct PTE *page_table, int table_cnt, int cluster_size, int cluster,
+                          int frame_pool[POOLMAX], int *frame_cnt) {
+    int first = cluster * cluster_size;
+    int last = first + cluster_size;
+    if (last > table_cnt) last = table_cnt;
+    for (int p = first; p < last; ++p) {
+        if (page_table[p].is_valid) {
+            push_frame_back_int(frame_pool, frame_cnt, page_table[p].frame_number);
+            invalidate_pte_zero(&page_table[p]);
+        }
+    }
+}
+
+static void load_page(struct PTE *p, int fn, int timestamp, int refcount) {
+    p->is_valid = 1;
+    p->frame_number = fn;
+    p->arrival_timestamp = timestamp;
+    p->last_access_timestamp = timestamp;
+    p->reference_count = refcount;
+}
+
+int count_page_faults_cluster(struct PTE *page_table, int table_cnt,
+                              int refrence_string[REFERENCEMAX], int reference_cnt,
+                              int frame_pool[POOLMAX], int frame_cnt,
+                              int cluster_size, int read_cluster, int *io_ops) {
+    int faults = 0;
+    int io = 0;
+    if (cluster_size <= 0) cluster_size = 1;
+
+    for (int i = 0; table_cnt > 0 && i < reference_cnt; ++i) {
+        int page = refrence_string[i];
+        int timestamp = i + 1; /* start at 1 per spec */
+
+        if (page < 0 || page >= table_cnt) {
+            faults++;
+            continue;
+        }
+        if (page_table[page].is_valid) {
+            /* hit */
+            page_table[page].last_access_timestamp = timestamp;
+            page_table[page].reference_count += 1;
+            continue;
+        }
+
+        faults++;
+        int cluster = page / cluster_size;
+        int first = page;
+        int last = page + 1;
+        if (read_cluster) {
+            first = cluster * cluster_size;
+            last = first + cluster_size;
+            if (last > table_cnt) last = table_cnt;
+        }
+        int want = 0;
+        for (int p = first; p < last; ++p)
+            if (!page_table[p].is_valid) want++;
+
+        /* make room by writing back whole clusters other than the faulting one */
+        while (frame_cnt < want) {
+            int victim = choose_lru_victim_cluster_pte(page_table, table_cnt, cluster_size, cluster);
+            if (victim < 0) break;
+            evict_cluster(page_table, table_cnt, cluster_size, victim / cluster_size,
+                          frame_pool, &frame_cnt);
+            io++;
+        }
+        if (frame_cnt == 0) {
+            /* the whole resident set lives in this cluster: evict a single page of it */
+            int victim = choose_lru_victim_pte(page_table, table_cnt);
+            if (victim < 0) continue;
+            push_frame_back_int(frame_pool, &frame_cnt, page_table[victim].frame_number);
+            invalidate_pte_zero(&page_table[victim]);
+            io++;
+        }
+
+        /* one read brings in the faulting page and, if enabled, its cluster */
+        load_page(&page_table[page], pop_frame_front_int(frame_pool, &frame_cnt), timestamp, 1);
+        for (int p = first; p < last && frame_cnt > 0; ++p) {
+            if (!page_table[p].is_valid)
+                load_page(&page_table[p], pop_frame_front_int(frame_pool, &frame_cnt), timestamp, 0);
+        }
+        io++;
+    }
+
+    if (io_ops) *io_ops = io;
+    return faults;
+}
+
+/* ---------------- MRU counting ----------------
+ * Victim is the most recently used page (largest last_access_timestamp;
+ * tie -> smallest arrival_timestamp; tie -> smallest frame_number).
+ * Timestamps start at 1 and victim fields are zeroed, as in LRU counting.
+ *
+ * Fast path: once the simulated timestamp passes every timestamp already in the
+ * table, the MRU page is simply the page referenced on the previous step, so the
+ * victim is found in O(1). Pre-existing entries with later timestamps fall back
+ * to the scanner until the run catches up with them.
+ */
+static int choose_mru_victim_pte(struct PTE *page_table, int table_cnt) {
+    int victim = -1;
+    int max_last = INT_MIN;
+    int min_arr = INT_MAX;
+    int min_frame = INT_MAX;
+    for (int i = 0; i < table_cnt; ++i) {
+        if (page_table[i].is_valid) {
+            int lat = page_table[i].last_access_timestamp;
+            int at = page_table[i].arrival_timestamp;
+            int fn = page_table[i].frame_number;
+            if (lat > max_last ||
+                (lat == max_last && at < min_arr) ||
+                (lat == max_last && at == min_arr && fn < min_frame)) {
+                max_last = lat;
+                min_arr = at;
+                min_frame = fn;
+                victim = i;
+            }
+        }
+    }
+    return victim;
+}
+
+int count_page_faults_mru(struct PTE *page_table, int table_cnt,
+                          int refrence_string[REFERENCEMAX], int reference_cnt,
+                          int frame_pool[POOLMAX], int frame_cnt) {
+    if (table_cnt <= 0) return 0;
+    int faults = 0;
+    int last_page = -1;  /* page referenced on the previous step */
+    int stale_max = INT_MIN;  /* latest timestamp found in the table on entry */
+
+    for (int i = 0; i < table_cnt; ++i)
+        if (page_table[i].is_valid && page_table[i].last_access_timestamp > stale_max)
+            stale_max = page_table[i].last_access_timestamp;
+
+    for (int i = 0; i < reference_cnt; ++i) {
+        int page = refrence_string[i];
+        int timestamp = i + 1; /* start at 1 per spec */
+
+        if (page < 0 || page >= table_cnt) {
+            faults++;
+            continue;
+        }
+        if (page_table[page].is_valid) {
+            /* hit */
+            page_table[page].last_access_timestamp = timestamp;
+            page_table[page].reference_count += 1;
+        } else {
+            faults++;
+            if (frame_cnt > 0) {
+                int fn = pop_frame_front_int(frame_pool, &frame_cnt);
+                load_page(&page_table[page], fn, timestamp, 1);
+            } else {
+                int victim;
+                if (last_page >= 0 && timestamp - 1 > stale_max && page_table[last_page].is_valid)
+                    victim = last_page;
+                else
+                    victim = choose_mru_victim_pte(page_table, table_cnt);
+                if (victim >= 0) {
+                    int freed = page_table[victim].frame_number;
+                    invalidate_pte_zero(&page_table[victim]);
+                    load_page(&page_table[page], freed, timestamp, 1);
+                }
+            }
+        }
+        last_page = page;
+    }
+    return faults;
+}
+
+/* ---------------- Random counting ----------------
+ * Victim is drawn uniformly from the resident pages with a xorshift32 PRNG, so
+ * a given seed always reproduces the same run. Resident pages are kept in a
+ * dense array with a per-page position index, making every step O(1).
+ * Timestamps start at 1 and victim fields are zeroed, as in LRU counting.
+ * Returns -1 if the bookkeeping arrays cannot be allocated.
+ */
+#define RANDOM_DEFAULT_SEED 0x2545F491u
+
+static unsigned int xorshift32(unsigned int *state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+int count_page_faults_random_seeded(struct PTE *page_table, int table_cnt,
+                                    int refrence_string[REFERENCEMAX], int reference_cnt,
+                                    int frame_pool[POOLMAX], int frame_cnt, unsigned int seed) {
+    if (table_cnt <= 0) return 0;
+    int *resident = malloc(sizeof(int) * (size_t)table_cnt);   /* dense list of valid pages */
+    if (!resident) return -1;
+    unsigned int state = seed ? seed : RANDOM_DEFAULT_SEED;
+    int nres = 0;
+    int faults = 0;
+
+    for (int i = 0; i < table_cnt; ++i)
+        if (page_table[i].is_valid) resident[nres++] = i;
+
+    for (int i = 0; i < reference_cnt; ++i) {
+        int page = refrence_string[i];
+        int timestamp = i + 1; /* start at 1 per spec */
+
+        if (page < 0 || page >= table_cnt) {
+            faults++;
+        } else if (page_table[page].is_valid) {
+            /* hit */
+            page_table[page].last_access_timestamp = timestamp;
+            page_table[page].reference_count += 1;
+        } else {
+            faults++;
+            int fn;
+            if (frame_cnt > 0) {
+                fn = pop_frame_front_int(frame_pool, &frame_cnt);
+            } else if (nres > 0) {
+                int slot = (int)(xorshift32(&state) % (unsigned int)nres);
+                int victim = resident[slot];
+                fn = page_table[victim].frame_number;
+                invalidate_pte_zero(&page_table[victim]);
+                /* swap-remove the victim; the incoming page is appended below */
+                resident[slot] = resident[--nres];
+            } else {
+                continue;
+            }
+            load_page(&page_table[page], fn, timestamp, 1);
+            resident[nres++] = page;
+        }
+    }
+
+    free(resident);
+    return faults;
+}
+
+int count_page_faults_random(struct PTE *page_table, int table_cnt,
+                             int refrence_string[REFERENCEMAX], int reference_cnt,
+                             int frame_pool[POOLMAX], int frame_cnt) {
+    return count_page_faults_random_seeded(page_table, table_cnt, refrence_string, reference_cnt,
+                                           frame_pool, frame_cnt, RANDOM_DEFAULT_SEED);
+}
+
+/* ---------------- Built-in policy vtables ----------------
+ * Used by the generic engine in vm_engine.c (observers, reclaim models, plugins
+ * sharing a run with built-ins). vm_policy_run() still calls the specialised
+ * counting loops above for plain runs.
+ */
+static int fifo_choose(void *state, struct PTE *page_table, int table_cnt, int timestamp) {
+    (void)state; (void)timestamp;
+    return choose_fifo_victim(page_table, table_cnt);
+}
+
+static int lru_choose(void *state, struct PTE *page_table, int table_cnt, int timestamp) {
+    (void)state; (void)timestamp;
+    return choose_lru_victim(page_table, table_cnt);
+}
+
+static int lfu_choose(void *state, struct PTE *page_table, int table_cnt, int timestamp) {
+    (void)state; (void)timestamp;
+    return choose_lfu_victim(page_table, table_cnt);
+}
+
+static int mru_choose(void *state, struct PTE *page_table, int table_cnt, int timestamp) {
+    (void)state; (void)timestamp;
+    return choose_mru_victim_pte(page_table, table_cnt);
+}
+
+/* Random: same resident list discipline as count_page_faults_random_seeded, so
+ * both paths draw the same victims for the same seed. The compact state keeps
+ * both arrays as uint16_t (0xffff for "not resident") when pages fit. */
+struct random_policy_state {
+    unsigned int prng;
+    int nres;
+    int narrow;
+    void *pos;
+    void *resident;
+};
+
+static int random_narrow(int table_cnt, int compact) {
+    return compact && table_cnt < 0xffff;
+}
+
+static size_t random_state_bytes(int table_cnt, int frame_cnt, int compact) {
+    (void)frame_cnt;
+    size_t n = table_cnt > 0 ? (size_t)table_cnt : 1;
+    size_t width = random_narrow(table_cnt, compact) ? sizeof(uint16_t) : sizeof(int);
+    return sizeof(struct random_policy_state) + 2 * n * width;
+}
+
+/* count_page_faults_random keeps only the resident list */
+static size_t random_count_bytes(int table_cnt, int frame_cnt) {
+    (void)frame_cnt;
+    return table_cnt > 0 ? sizeof(int) * (size_t)table_cnt : 0;
+}
+
+static int rs_get(const struct random_policy_state *st, const void *a, int i) {
+    if (!st->narrow) return ((const int *)a)[i];
+    uint16_t v = ((const uint16_t *)a)[i];
+    return v == 0xffff ? -1 : v;
+}
+
+static void rs_set(const struct random_policy_state *st, void *a, int i, int v) {
+    if (st->narrow) ((uint16_t *)a)[i] = (uint16_t)v;
+    else ((int *)a)[i] = v;
+}
+
+static void *random_create_width(int table_cnt, int compact) {
+    struct random_policy_state *st = calloc(1, sizeof(*st));
+    if (!st) return NULL;
+    size_t n = table_cnt > 0 ? (size_t)table_cnt : 1;
+    st->narrow = random_narrow(table_cnt, compact);
+    size_t width = st->narrow ? sizeof(uint16_t) : sizeof(int);
+    st->pos = malloc(width * n);
+    st->resident = malloc(width * n);
+    if (!st->pos || !st->resident) {
+        free(st->pos);
+        free(st->resident);
+        free(st);
+        return NULL;
+    }
+    for (int i = 0; i < table_cnt; ++i) rs_set(st, st->pos, i, -1);
+    st->prng = RANDOM_DEFAULT_SEED;
+    return st;
+}
+
+static void *random_create(int table_cnt, int frame_cnt) {
+    (void)frame_cnt;
+    return random_create_width(table_cnt, 0);
+}
+
+static void *random_create_compact(int table_cnt, int frame_cnt) {
+    (void)frame_cnt;
+    return random_create_width(table_cnt, 1);
+}
+
+static void random_destroy(void *state) {
+    struct random_policy_state *st = state;
+    free(st->pos);
+    free(st->resident);
+    free(st);
+}
+
+static void random_on_fault(void *state, struct PTE *page_table, int page, int timestamp) {
+    struct random_policy_state *st = state;
+    (void)page_table; (void)timestamp;
+    rs_set(st, st->pos, page, st->nres);
+    rs_set(st, st->resident, st->nres++, page);
+}
+
+static void random_on_evict(void *state, struct PTE *page_table, int page, int timestamp) {
+    struct random_policy_state *st = state;
+    (void)page_table; (void)timestamp;
+    int slot = rs_get(st, st->pos, page);
+    int last = rs_get(st, st->resident, --st->nres);
+    rs_set(st, st->resident, slot, last);
+    rs_set(st, st->pos, last, slot);
+    rs_set(st, st->pos, page, -1);
+}
+
+static int random_choose(void *state, struct PTE *page_table, int table_cnt, int timestamp) {
+    struct random_policy_state *st = state;
+    (void)page_table; (void)table_cnt; (void)timestamp;
+    if (st->nres == 0) return -1;
+    return rs_get(st, st->resident, (int)(xorshift32(&st->prng) % (unsigned int)st->nres));
+}
+
+const struct vm_builtin_policy vm_builtin_policies[] = {
+    { { VM_POLICY_ABI_VERSION, "fifo", NULL, NULL, NULL, NULL, fifo_choose, NULL, NULL, NULL },
+      count_page_faults_fifo, NULL },
+    { { VM_POLICY_ABI_VERSION, "lru", NULL, NULL, NULL, NULL, lru_choose, NULL, NULL, NULL },
+      count_page_faults_lru, NULL },
+    { { VM_POLICY_ABI_VERSION, "lfu", NULL, NULL, NULL, NULL, lfu_choose, NULL, NULL, NULL },
+      count_page_faults_lfu, NULL },
+    { { VM_POLICY_ABI_VERSION, "mru", NULL, NULL, NULL, NULL, mru_choose, NULL, NULL, NULL },
+      count_page_faults_mru, NULL },
+    { { VM_POLICY_ABI_VERSION, "random", random_create, random_destroy, NULL,
+        random_on_fault, random_choose, random_on_evict, random_state_bytes,
+        random_create_compact },
+      count_page_faults_random, random_count_bytes },
+    { { 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL }, NULL, NULL }
+};
@@ -0,0 +1,260 @@
+/*
+ * vm_engine.c
+ *
+ * Vtable-driven replacement engine and plugin loader. PTE bookkeeping mirrors
+ * count_page_faults_lru: loads set arrival/last access to the timestamp and
+ * reference_count to 1, hits bump last access and reference_count, and evicted
+ * entries are zeroed.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dlfcn.h>
+
+#include "vm_engine.h"
+
+static void free_frame_push(struct vm_engine *e, int fn) {
+    e->free_frames[(e->free_head + e->free_cnt) % e->frame_cap] = fn;
+    e->free_cnt++;
+}
+
+static int free_frame_pop(struct vm_engine *e) {
+    int fn = e->free_frames[e->free_head];
+    e->free_head = (e->free_head + 1) % e->frame_cap;
+    e->free_cnt--;
+    return fn;
+}
+
+static size_t state_bytes(const struct vm_policy_ops *ops, int table_cnt, int frame_cnt,
+                          int compact) {
+    if (ops->abi_version < 2 || !ops->state_bytes) return 0;
+    return ops->state_bytes(table_cnt, frame_cnt, compact);
+}
+
+int vm_policy_compact(const struct vm_policy_ops *ops, int table_cnt, int frame_cnt,
+                      size_t state_cap) {
+    return ops->abi_version >= 2 && ops->create_compact &&
+           state_bytes(ops, table_cnt, frame_cnt, 0) > state_cap;
+}
+
+static const struct vm_builtin_policy *find_builtin(const struct vm_policy_ops *ops) {
+    for (const struct vm_builtin_policy *b = vm_builtin_policies; b->ops.name; ++b)
+        if (ops == &b->ops) return b;
+    return NULL;
+}
+
+size_t vm_policy_footprint(const struct vm_policy_ops *ops, int table_cnt, int frame_cnt,
+                           size_t state_cap) {
+    size_t tc = table_cnt > 0 ? (size_t)table_cnt : 1;
+    size_t fc = frame_cnt > 0 ? (size_t)frame_cnt : 1;
+    size_t bytes = tc * sizeof(struct PTE) + fc * sizeof(int);
+    int compact = vm_policy_compact(ops, table_cnt, frame_cnt, state_cap);
+    const struct vm_builtin_policy *b = find_builtin(ops);
+    /* the counting loops of the built-ins keep their own, smaller state */
+    if (b && !compact) return bytes + (b->count_bytes ? b->count_bytes(table_cnt, frame_cnt) : 0);
+    bytes += sizeof(struct vm_engine) + fc * sizeof(int);
+    return bytes + state_bytes(ops, table_cnt, frame_cnt, compact);
+}
+
+int vm_engine_init(struct vm_engine *e, const struct vm_policy_ops *ops,
+                   struct PTE *page_table, int table_cnt,
+                   const int *frame_pool, int frame_cnt) {
+    return vm_engine_init_capped(e, ops, page_table, table_cnt, frame_pool, frame_cnt, SIZE_MAX);
+}
+
+int vm_engine_init_capped(struct vm_engine *e, const struct vm_policy_ops *ops,
+                          struct PTE *page_table, int table_cnt,
+                          const int *frame_pool, int frame_cnt, size_t state_cap) {
+    memset(e, 0, sizeof(*e));
+    if (!ops || !ops->choose_victim || table_cnt < 0 || frame_cnt < 0) return -1;
+    e->ops = ops;
+    e->page_table = page_table;
+    e->table_cnt = table_cnt;
+
+    for (int i = 0; i < table_cnt; ++i)
+        if (page_table[i].is_valid) e->resident++;
+
+    /* frames of pages already resident may be freed later, so size for both */
+    e->frame_cap = frame_cnt + e->resident;
+    if (e->frame_cap > 0) {
+        e->free_frames = malloc(sizeof(int) * (size_t)e->frame_cap);
+        if (!e->free_frames) return -1;
+    }
+    for (int i = 0; i < frame_cnt; ++i) free_frame_push(e, frame_pool[i]);
+
+    e->compact = vm_policy_compact(ops, table_cnt, frame_cnt, state_cap);
+    if (ops->create) {
+        e->state = e->compact ? ops->create_compact(table_cnt, frame_cnt)
+                              : ops->create(table_cnt, frame_cnt);
+        if (!e->state) {
+            free(e->free_frames);
+            e->free_frames = NULL;
+            return -1;
+        }
+    }
+    if (ops->on_fault) {
+        for (int i = 0; i < table_cnt; ++i)
+            if (page_table[i].is_valid)
+                ops->on_fault(e->state, page_table, i, page_table[i].arrival_timestamp);
+    }
+    return 0;
+}
+
+void vm_engine_destroy(struct vm_engine *e) {
+    if (e->ops && e->ops->destroy && e->state) e->ops->destroy(e->state);
+    free(e->free_frames);
+    memset(e, 0, sizeof(*e));
+}
+
+/* Evict victim, returning its frame */
+static int evict_page(struct vm_engine *e, int victim, int timestamp) {
+    struct PTE *p = &e->page_table[victim];
+    int fn = p->frame_number;
+    if (e->ops->on_evict) e->ops->on_evict(e->state, e->page_table, victim, timestamp);
+    if (e->obs && e->obs->on_evict) e->obs->on_evict(e->obs->ctx, victim, timestamp);
+    p->is_valid = 0;
+    p->frame_number = -1;
+    p->arrival_timestamp = 0;
+    p->last_access_timestamp = 0;
+    p->reference_count = 0;
+    e->resident--;
+    return fn;
+}
+
+static int choose_valid_victim(struct vm_engine *e, int timestamp) {
+    int victim = e->ops->choose_victim(e->state, e->page_table, e->table_cnt, timestamp);
+    if (victim < 0 || victim >= e->table_cnt || !e->page_table[victim].is_valid) return -1;
+    return victim;
+}
+
+static int access_page(struct vm_engine *e, int page, int timestamp) {
+    if (page < 0 || page >= e->table_cnt) return 1;  /* counted as a fault, like the counters */
+    struct PTE *p = &e->page_table[page];
+
+    if (p->is_valid) {
+        p->last_access_timestamp = timestamp;
+        p->reference_count += 1;
+        if (e->ops->on_hit) e->ops->on_hit(e->state, e->page_table, page, timestamp);
+        return 0;
+    }
+
+    int fn;
+    if (e->free_cnt > 0) {
+        fn = free_frame_pop(e);
+    } else if (e->resident == 0) {
+        return 1;   /* no frames at all: a miss that loads nothing, like the counters */
+    } else {
+        int victim = choose_valid_victim(e, timestamp);
+        if (victim < 0) return -1;
+        fn = evict_page(e, victim, timestamp);
+    }
+    p->is_valid = 1;
+    p->frame_number = fn;
+    p->arrival_timestamp = timestamp;
+    p->last_access_timestamp = timestamp;
+    p->reference_count = 1;
+    e->resident++;
+    if (e->ops->on_fault) e->ops->on_fault(e->state, e->page_table, page, timestamp);
+    return 1;
+}
+
+int vm_engine_access(struct vm_engine *e, int page, int timestamp) {
+    int r = access_page(e, page, timestamp);
+    if (r >= 0 && e->obs && e->obs->on_access) e->obs->on_access(e->obs->ctx, page, timestamp, r);
+    return r;
+}
+
+int vm_engine_evict(struct vm_engine *e, int timestamp) {
+    int victim = choose_valid_victim(e, timestamp);
+    if (victim < 0) return -1;
+    free_frame_push(e, evict_page(e, victim, timestamp));
+    return victim;
+}
+
+static int run_vtable(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                      int refrence_string[REFERENCEMAX], int reference_cnt,
+                      int frame_pool[POOLMAX], int frame_cnt, const struct vm_observer *obs,
+                      size_t state_cap) {
+    if (table_cnt <= 0) return 0;
+    struct vm_engine e;
+    if (vm_engine_init_capped(&e, ops, page_table, table_cnt, frame_pool, frame_cnt,
+                              state_cap) < 0)
+        return -1;
+    e.obs = obs;
+    int faults = 0;
+    for (int i = 0; i < reference_cnt; ++i) {
+        int r = vm_engine_access(&e, refrence_string[i], i + 1);
+        if (r > 0) faults++;
+    }
+    vm_engine_destroy(&e);
+    return faults;
+}
+
+int vm_policy_run(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                  int refrence_string[REFERENCEMAX], int reference_cnt,
+                  int frame_pool[POOLMAX], int frame_cnt) {
+    for (const struct vm_builtin_policy *b = vm_builtin_policies; b->ops.name; ++b) {
+        if (ops == &b->ops)
+            return b->count(page_table, table_cnt, refrence_string, reference_cnt,
+                            frame_pool, frame_cnt);
+    }
+    return run_vtable(ops, page_table, table_cnt, refrence_string, reference_cnt,
+                      frame_pool, frame_cnt, NULL, SIZE_MAX);
+}
+
+int vm_policy_run_capped(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                         int refrence_string[REFERENCEMAX], int reference_cnt,
+                         int frame_pool[POOLMAX], int frame_cnt, size_t state_cap) {
+    if (!vm_policy_compact(ops, table_cnt, frame_cnt, state_cap))
+        return vm_policy_run(ops, page_table, table_cnt, refrence_string, reference_cnt,
+                             frame_pool, frame_cnt);
+    return run_vtable(ops, page_table, table_cnt, refrence_string, reference_cnt,
+                      frame_pool, frame_cnt, NULL, state_cap);
+}
+
+int vm_policy_run_observed(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                           int refrence_string[REFERENCEMAX], int reference_cnt,
+                           int frame_pool[POOLMAX], int frame_cnt,
+                           const struct vm_observer *obs) {
+    return run_vtable(ops, page_table, table_cnt, refrence_string, reference_cnt,
+                      frame_pool, frame_cnt, obs, SIZE_MAX);
+}
+
+const struct vm_policy_ops *vm_policy_find(const char *name) {
+    for (const struct vm_builtin_policy *b = vm_builtin_policies; b->ops.name; ++b)
+        if (strcmp(b->ops.name, name) == 0) return &b->ops;
+    return NULL;
+}
+
+int vm_plugin_load(struct vm_plugin *pl, const char *path) {
+    memset(pl, 0, sizeof(*pl));
+    pl->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!pl->handle) {
+        pl->error = dlerror();
+        return -1;
+    }
+
+    vm_policy_entry_fn entry;
+    /* POSIX guarantees object/function pointer conversion for dlsym */
+    *(void **)&entry = dlsym(pl->handle, VM_POLICY_ENTRY);
+    const struct vm_policy_ops *ops = entry ? entry() : NULL;
+    if (!entry) {
+        pl->error = "missing " VM_POLICY_ENTRY " symbol";
+    } else if (!ops || !ops->name || !ops->choose_victim) {
+        pl->error = "plugin returned an incomplete vm_policy_ops";
+    } else if (ops->abi_version < 1 || ops->abi_version > VM_POLICY_ABI_VERSION) {
+        pl->error = "unsupported plugin ABI version";
+    } else {
+        pl->ops = ops;
+        return 0;
+    }
+    dlclose(pl->handle);
+    pl->handle = NULL;
+    return -1;
+}
+
+void vm_plugin_unload(struct vm_plugin *pl) {
+    if (pl->handle) dlclose(pl->handle);
+    memset(pl, 0, sizeof(*pl));
+}
@@ -0,0 +1,111 @@
+/*
+ * vm_engine.h
+ *
+ * Generic replacement engine driven by a struct vm_policy_ops vtable, the
+ * built-in policy tables, and the dlopen loader for out-of-tree policies.
+ */
+
+#ifndef VM_ENGINE_H
+#define VM_ENGINE_H
+
+#include "vm_policy.h"
+
+/* Built-in policy: the vtable plus the specialised counting loop from virtual.c,
+ * which vm_policy_run() calls directly instead of going through the vtable. */
+struct vm_builtin_policy {
+    struct vm_policy_ops ops;
+    int (*count)(struct PTE *page_table, int table_cnt,
+                 int refrence_string[REFERENCEMAX], int reference_cnt,
+                 int frame_pool[POOLMAX], int frame_cnt);
+    /* heap bytes count allocates, NULL for none */
+    size_t (*count_bytes)(int table_cnt, int frame_cnt);
+};
+
+/* fifo, lru, lfu, mru, random; terminated by an entry with a NULL name */
+extern const struct vm_builtin_policy vm_builtin_policies[];
+
+/* Optional per-event hooks for analyses layered on a run (heatmaps, phase
+ * statistics, ...). Either callback may be NULL. */
+struct vm_observer {
+    void *ctx;
+    /* every reference, after the engine has handled it */
+    void (*on_access)(void *ctx, int page, int timestamp, int fault);
+    /* page is being evicted (before on_access of the reference that caused it) */
+    void (*on_evict)(void *ctx, int page, int timestamp);
+};
+
+/* One simulation in progress. Free frames live in a ring so that frames freed
+ * by eviction can be handed out again in FIFO order. */
+struct vm_engine {
+    const struct vm_policy_ops *ops;
+    void *state;
+    struct PTE *page_table;
+    int table_cnt;
+    int *free_frames;
+    int free_head;
+    int free_cnt;
+    int frame_cap;
+    int resident;
+    const struct vm_observer *obs;   /* may be NULL */
+    int compact;                     /* state came from create_compact */
+};
+
+/* Returns 0, or -1 if allocation or the policy's create fails */
+int vm_engine_init(struct vm_engine *e, const struct vm_policy_ops *ops,
+                   struct PTE *page_table, int table_cnt,
+                   const int *frame_pool, int frame_cnt);
+/* Same, but a policy whose full state would exceed state_cap bytes gets its
+ * compact state when it has one */
+int vm_engine_init_capped(struct vm_engine *e, const struct vm_policy_ops *ops,
+                          struct PTE *page_table, int table_cnt,
+                          const int *frame_pool, int frame_cnt, size_t state_cap);
+void vm_engine_destroy(struct vm_engine *e);
+
+/* Reference page at timestamp: 1 on fault, 0 on hit, -1 if the policy names no
+ * valid victim. With no frames at all every miss is a fault that loads nothing. */
+int vm_engine_access(struct vm_engine *e, int page, int timestamp);
+
+/* Evict the policy's victim and free its frame; returns the page or -1 */
+int vm_engine_evict(struct vm_engine *e, int timestamp);
+
+/* Same contract as count_page_faults_*: timestamps start at 1. Built-in
+ * policies run their specialised loop; anything else goes through the vtable. */
+int vm_policy_run(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                  int refrence_string[REFERENCEMAX], int reference_cnt,
+                  int frame_pool[POOLMAX], int frame_cnt);
+
+/* vm_policy_run under a state cap; compact runs always go through the vtable */
+int vm_policy_run_capped(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                         int refrence_string[REFERENCEMAX], int reference_cnt,
+                         int frame_pool[POOLMAX], int frame_cnt, size_t state_cap);
+
+/* Whether a run under state_cap would use the policy's compact state */
+int vm_policy_compact(const struct vm_policy_ops *ops, int table_cnt, int frame_cnt,
+                      size_t state_cap);
+
+/* Metadata bytes of one vm_policy_run_capped on a fresh table: page table,
+ * frame pool, then engine, free ring and policy state on the vtable path, or
+ * what a built-in's counting loop allocates */
+size_t vm_policy_footprint(const struct vm_policy_ops *ops, int table_cnt, int frame_cnt,
+                           size_t state_cap);
+
+/* vm_policy_run with an observer attached; always goes through the vtable */
+int vm_policy_run_observed(const struct vm_policy_ops *ops, struct PTE *page_table, int table_cnt,
+                           int refrence_string[REFERENCEMAX], int reference_cnt,
+                           int frame_pool[POOLMAX], int frame_cnt,
+                           const struct vm_observer *obs);
+
+/* Built-in policy by name, or NULL */
+const struct vm_policy_ops *vm_policy_find(const char *name);
+
+struct vm_plugin {
+    void *handle;
+    const struct vm_policy_ops *ops;
+    const char *error;  /* set when vm_plugin_load fails */
+};
+
+/* dlopen a policy shared object; returns 0 or -1 with pl->error set */
+int vm_plugin_load(struct vm_plugin *pl, const char *path);
+void vm_plugin_unload(struct vm_plugin *pl);
+
+#endif /* VM_ENGINE_H */
@@ -0,0 +1,58 @@
+/*
+ * vm_policy.h
+ *
+ * Replacement policy plugin ABI.
+ *
+ * A policy is a table of callbacks plus per-run state. The engine owns the page
+ * table and the frame pool: it updates is_valid/frame_number/timestamps/
+ * reference_count exactly like the counting functions in virtual.c, and only
+ * asks the policy which page to evict. Callbacks other than choose_victim may
+ * be NULL.
+ *
+ * Out-of-tree plugins are shared objects exporting VM_POLICY_ENTRY:
+ *
+ *     const struct vm_policy_ops *vm_policy_entry(void);
+ *
+ * The ABI only grows by appending fields; abi_version tells the engine which
+ * fields the plugin knows about.
+ */
+
+#ifndef VM_POLICY_H
+#define VM_POLICY_H
+
+#include <stddef.h>
+
+#include "oslabs.h"
+
+#define VM_POLICY_ABI_VERSION 2
+#define VM_POLICY_ENTRY "vm_policy_entry"
+
+struct vm_policy_ops {
+    int abi_version;    /* VM_POLICY_ABI_VERSION the policy was built against */
+    const char *name;
+
+    /* Per-run state; NULL create means the policy is stateless */
+    void *(*create)(int table_cnt, int frame_cnt);
+    void (*destroy)(void *state);
+
+    /* page was valid and has just been touched (timestamp/refcount already updated) */
+    void (*on_hit)(void *state, struct PTE *page_table, int page, int timestamp);
+    /* page has just been loaded; pages already valid on entry are reported here too */
+    void (*on_fault)(void *state, struct PTE *page_table, int page, int timestamp);
+    /* return a valid page to evict, or -1 if none */
+    int (*choose_victim)(void *state, struct PTE *page_table, int table_cnt, int timestamp);
+    /* page is about to be invalidated (its PTE still holds the old values) */
+    void (*on_evict)(void *state, struct PTE *page_table, int page, int timestamp);
+
+    /* ABI 2 */
+
+    /* exact bytes create (compact 0) or create_compact (compact 1) allocates
+     * for these sizes; NULL counts as 0 */
+    size_t (*state_bytes)(int table_cnt, int frame_cnt, int compact);
+    /* smaller, possibly slower state with identical decisions; NULL if none */
+    void *(*create_compact)(int table_cnt, int frame_cnt);
+};
+
+typedef const struct vm_policy_ops *(*vm_policy_entry_fn)(void);
+
+#endif /* VM_POLICY_H */
@@ -0,0 +1,38 @@
+/*
+ * vm_simd.h
+ *
+ * Vectorised page table scans with runtime CPU dispatch. The implementation is
+ * picked once, on first use, from CPUID (SSE4.1, AVX2); setting
+ * VMSIM_SIMD=scalar|sse4.1|avx2|avx512 caps it, disables it, or opts into the
+ * AVX-512F kernel.
+ */
+
+#ifndef VM_SIMD_H
+#define VM_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "oslabs.h"
+
+/* int field of struct PTE, as an index for the scan kernels */
+#define VM_PTE_FIELD(member) ((int)(offsetof(struct PTE, member) / sizeof(int)))
+
+/* Smallest value of the given field among valid entries (INT_MAX if none).
+ * *first receives the lowest index holding it and *count how many entries do;
+ * either pointer may be NULL. */
+int vm_min_valid_field(const struct PTE *page_table, int table_cnt, int field,
+                       int *first, int *count);
+
+/* Slot of key among the VM_BUCKET_SLOTS keys of a 64-byte aligned bucket,
+ * -1 if absent */
+#define VM_BUCKET_SLOTS 8
+int vm_bucket_find(const uint64_t *keys, uint64_t key);
+
+/* Non-zero when a vector kernel is in use (the scalar choosers are faster otherwise) */
+int vm_simd_enabled(void);
+
+/* "scalar", "sse4.1", "avx2" or "avx512" */
+const char *vm_simd_variant(void);
+
+#endif /* VM_SIMD_H */
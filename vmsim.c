@@ -0,0 +1,1510 @@
+/*
+ * vmsim.c
+ *
+ * Trace replay driver: runs every (policy, frame count) pair over a reference
+ * trace and prints faults, hit ratio and wall time per run. Runs are spread
+ * over a pool of worker threads (one per online CPU by default).
+ *
+ * Trace format: page numbers separated by whitespace or commas; '#' starts a
+ * comment that runs to the end of the line. "-" reads standard input. With
+ * --page-sizes the entries are byte addresses instead, decimal or 0x hex; a
+ * --ksm file holds one content hash per reference in the same form.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "oslabs.h"
+#include "vm_engine.h"
+#include "vm_simd.h"
+#include "heatmap.h"
+#include "advise.h"
+#include "phase.h"
+#include "cgroup.h"
+#include "kswapd.h"
+#include "latency.h"
+#include "balloon.h"
+#include "stackdist.h"
+#include "belady.h"
+#include "frametab.h"
+#include "hashpt.h"
+#include "pagesize.h"
+#include "thp.h"
+#include "ksm.h"
+#include "nested.h"
+
+#define MAX_POLICIES 32
+#define MAX_PLUGINS 8
+
+/* long-only options */
+enum {
+    OPT_HEATMAP = 256,
+    OPT_HOT,
+    OPT_COLD,
+    OPT_ADVISE,
+    OPT_HUGE_PAGES,
+    OPT_PHASES,
+    OPT_PHASE_THRESHOLD,
+    OPT_MEMORY_HIGH,
+    OPT_MEMORY_MAX,
+    OPT_WATERMARKS,
+    OPT_KSWAPD_RATE,
+    OPT_LATENCY,
+    OPT_LATENCY_COSTS,
+    OPT_MEM_BUDGET,
+    OPT_STATE_CAP,
+    OPT_STACK_DISTANCE,
+    OPT_BELADY,
+    OPT_FRAME_TABLE,
+    OPT_HASHED_PT,
+    OPT_PAGE_SIZES,
+    OPT_THP,
+    OPT_COMPACTION,
+    OPT_KSM,
+    OPT_KSM_SCAN,
+    OPT_NESTED,
+    OPT_BALLOON,
+    OPT_BALLOON_ADJUST,
+};
+
+struct trace {
+    int *refs;
+    int count;
+    int table_cnt;   /* largest page + 1 */
+};
+
+struct job {
+    const struct vm_policy_ops *ops;
+    int frames;
+    size_t bytes;       /* vm_policy_footprint */
+    int faults;
+    double ms;
+};
+
+struct job_queue {
+    struct job *jobs;
+    int njobs;
+    int next;
+    const struct trace *trace;
+    int table_cnt;
+    size_t state_cap;
+    size_t budget;      /* jobs start only while their footprints fit */
+    size_t in_use;
+    pthread_mutex_t lock;
+    pthread_cond_t room;
+};
+
+static void usage(FILE *out) {
+    fprintf(out,
+            "usage: vmsim [options] TRACE\n"
+            "  -p, --policies LIST   comma separated policies (default fifo,lru,lfu)\n"
+            "                        built-in: fifo lru lfu mru random\n"
+            "  -f, --frames LIST     frame counts: N, A-B or A-B:STEP, comma separated (default 4)\n"
+            "  -t, --table-size N    page table entries (default: largest page + 1);\n"
+            "                        pages beyond it count as faults\n"
+            "  -j, --jobs N          worker threads (default: online CPUs)\n"
+            "  -P, --plugin FILE     load a policy shared object (repeatable)\n"
+            "      --mem-budget SIZE start runs only while their metadata fits in SIZE bytes\n"
+            "      --state-cap SIZE  use compact policy state above SIZE bytes per run\n"
+            "                        (SIZE takes a K, M or G suffix)\n"
+            "  -h, --help            show this help\n"
+            "\n"
+            "Analyses use the first frame count; --heatmap and --advise also use only the first policy:\n"
+            "      --heatmap FILE    write the per-page columnar summary to FILE\n"
+            "      --hot N           hot page threshold in references (default 2x mean)\n"
+            "      --cold N          cold page threshold in references (default 1)\n"
+            "      --advise FILE     write madvise/mlock recommendations to FILE (\"-\": stdout)\n"
+            "      --huge-pages N    pages per huge page for MADV_HUGEPAGE (default 512)\n"
+            "      --phases N        split faults of every policy by phase, N references per interval\n"
+            "      --phase-threshold D\n"
+            "                        Jaccard distance that starts a new phase (default 0.5)\n"
+            "      --memory-high N   cgroup soft limit in pages, for every policy\n"
+            "      --memory-max N    cgroup hard limit in pages, for every policy\n"
+            "      --watermarks LOW,HIGH[,MIN]\n"
+            "                        background reclaim watermarks in free frames, for every policy\n"
+            "      --kswapd-rate R   pages reclaimed in the background per reference (default 1)\n"
+            "      --latency         per-access latency percentiles for every policy\n"
+            "      --latency-costs HIT,WALK,FAULT,RECLAIM[,TLB]\n"
+            "                        cost model in ns and TLB entries (default 80,40,25000,15000,64)\n"
+            "      --stack-distance LIST\n"
+            "                        answer every frame count from one stack-distance pass\n"
+            "                        (lru, opt); other policies need a full replay\n"
+            "      --belady          scan every listed frame count with FIFO for Belady's anomaly\n"
+            "                        and print a minimal reproducer for each one found\n"
+            "      --frame-table     replay fifo, lru and lfu through the inverted frame table,\n"
+            "                        timed against the page-table scanners\n"
+            "      --hashed-pt       replay LRU through a cuckoo hashed page table and report\n"
+            "                        probes, displacements and resizes\n"
+            "      --page-sizes LIST read TRACE as byte addresses and replay LRU at every page\n"
+            "                        size in LIST (e.g. 4K,16K,64K,2M) in one pass; memory is\n"
+            "                        the first frame count times the smallest size\n"
+            "      --thp             map huge pages (--huge-pages, a power of two) from a buddy\n"
+            "                        allocator under fifo and lru; report coverage and fragmentation\n"
+            "      --compaction MODE[,N]\n"
+            "                        with --thp: none, direct (on a fragmented huge fault) or\n"
+            "                        background (every N references, default 1000)\n"
+            "      --ksm FILE        merge pages of equal content under fifo and lru; FILE has\n"
+            "                        the page's content hash after each reference\n"
+            "      --ksm-scan N,PAGES\n"
+            "                        scan PAGES frames for merging every N references\n"
+            "                        (default 100,100; N of 0 disables merging)\n"
+            "      --nested HOST_FRAMES[,HOST_POLICY]\n"
+            "                        run each policy as a guest on the first frame count, backed\n"
+            "                        by HOST_FRAMES host frames under HOST_POLICY (default lru);\n"
+            "                        report host faults, double paging and 2D walk cost\n"
+            "      --balloon GUESTS,HOST_FRAMES[,HOST_POLICY]\n"
+            "                        run GUESTS copies of the trace, each starting further in,\n"
+            "                        as guests of the first frame count on HOST_FRAMES frames;\n"
+            "                        compare host swap (HOST_POLICY, default lru) against\n"
+            "                        ballooning on faults and --latency-costs latency\n"
+            "      --balloon-adjust N,STEP\n"
+            "                        move STEP frames between balloons every N rounds\n"
+            "                        (default 1000,4; STEP of 0 keeps an even split)\n");
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int parse_int(const char *s, char **end, int *out) {
+    errno = 0;
+    long v = strtol(s, end, 10);
+    if (*end == s || errno || v < 0 || v > 0x7fffffff) return -1;
+    *out = (int)v;
+    return 0;
+}
+
+/* Byte count with an optional K/M/G suffix */
+static int parse_size(const char *s, size_t *out) {
+    char *end;
+    errno = 0;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (end == s || errno || *s == '-') return -1;
+    int shift = 0;
+    switch (*end) {
+    case 'K': case 'k': shift = 10; end++; break;
+    case 'M': case 'm': shift = 20; end++; break;
+    case 'G': case 'g': shift = 30; end++; break;
+    }
+    if (*end || v > (SIZE_MAX >> shift)) return -1;
+    *out = (size_t)(v << shift);
+    return 0;
+}
+
+/* Read a whole trace; returns 0 or -1 with a message printed */
+static int load_trace(const char *path, struct trace *t) {
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "vmsim: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    int cap = 1024;
+    t->refs = malloc(sizeof(int) * (size_t)cap);
+    t->count = 0;
+    t->table_cnt = 0;
+    int rc = t->refs ? 0 : -1;
+    int lineno = 1;
+    int c = getc(f);
+
+    while (rc == 0 && c != EOF) {
+        if (c == '#') {
+            while (c != EOF && c != '\n') c = getc(f);
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == ',' || c == '\r' || c == '\n') {
+            if (c == '\n') lineno++;
+            c = getc(f);
+            continue;
+        }
+        long page = 0;
+        if (c < '0' || c > '9') {
+            fprintf(stderr, "vmsim: %s:%d: bad page number\n", path, lineno);
+            rc = -1;
+            break;
+        }
+        for (; c >= '0' && c <= '9'; c = getc(f)) {
+            page = page * 10 + (c - '0');
+            if (page > 0x7fffffff) {
+                fprintf(stderr, "vmsim: %s:%d: page number too large\n", path, lineno);
+                rc = -1;
+                break;
+            }
+        }
+        if (rc < 0) break;
+        if (t->count == cap) {
+            int *grown = realloc(t->refs, sizeof(int) * (size_t)cap * 2);
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            t->refs = grown;
+            cap *= 2;
+        }
+        t->refs[t->count++] = (int)page;
+        if (page >= t->table_cnt) t->table_cnt = (int)page + 1;
+    }
+    if (rc == 0 && ferror(f)) {
+        fprintf(stderr, "vmsim: %s: read error\n", path);
+        rc = -1;
+    }
+    if (f != stdin) fclose(f);
+    if (rc < 0) {
+        free(t->refs);
+        t->refs = NULL;
+    }
+    return rc;
+}
+
+/* Read 64-bit values (addresses, hashes) named what in messages; returns 0
+ * or -1 with a message printed */
+static int load_values(const char *path, const char *what, uint64_t **out, long long *count) {
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "vmsim: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    long long cap = 1024, n = 0;
+    uint64_t *addrs = malloc(sizeof(uint64_t) * (size_t)cap);
+    int rc = addrs ? 0 : -1;
+    int lineno = 1;
+    char tok[32];
+
+    while (rc == 0) {
+        int c = getc(f);
+        if (c == EOF) break;
+        if (c == '#') {
+            while (c != EOF && c != '\n') c = getc(f);
+            lineno++;
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == ',' || c == '\r' || c == '\n') {
+            if (c == '\n') lineno++;
+            continue;
+        }
+        int len = 0;
+        for (; c != EOF && c != ' ' && c != '\t' && c != ',' && c != '\r' && c != '\n' &&
+               c != '#'; c = getc(f))
+            if (len < (int)sizeof(tok) - 1) tok[len++] = (char)c;
+        tok[len] = '\0';
+        if (c != EOF) ungetc(c, f);
+        char *end;
+        errno = 0;
+        unsigned long long a = strtoull(tok, &end, 0);
+        if (end == tok || *end || errno || tok[0] == '-') {
+            fprintf(stderr, "vmsim: %s:%d: bad %s '%s'\n", path, lineno, what, tok);
+            rc = -1;
+            break;
+        }
+        if (n == cap) {
+            uint64_t *grown = realloc(addrs, sizeof(uint64_t) * (size_t)cap * 2);
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            addrs = grown;
+            cap *= 2;
+        }
+        addrs[n++] = a;
+    }
+    if (rc == 0 && ferror(f)) {
+        fprintf(stderr, "vmsim: %s: read error\n", path);
+        rc = -1;
+    }
+    if (f != stdin) fclose(f);
+    if (rc < 0) {
+        free(addrs);
+        return -1;
+    }
+    *out = addrs;
+    *count = n;
+    return 0;
+}
+
+/* Parse "4,8,16-64:16" into a list of frame counts */
+static int parse_frames(const char *arg, int **out, int *n) {
+    int cap = 16;
+    int *list = malloc(sizeof(int) * (size_t)cap);
+    *n = 0;
+    if (!list) return -1;
+    const char *p = arg;
+    while (*p) {
+        char *end;
+        int lo, hi, step = 1;
+        if (parse_int(p, &end, &lo) < 0) goto bad;
+        hi = lo;
+        if (*end == '-') {
+            if (parse_int(end + 1, &end, &hi) < 0 || hi < lo) goto bad;
+            if (*end == ':' && (parse_int(end + 1, &end, &step) < 0 || step < 1)) goto bad;
+        }
+        if (*end != ',' && *end != '\0') goto bad;
+        for (long f = lo; f <= hi; f += step) {
+            if (*n == cap) {
+                int *grown = realloc(list, sizeof(int) * (size_t)cap * 2);
+                if (!grown) goto bad;
+                list = grown;
+                cap *= 2;
+            }
+            list[(*n)++] = (int)f;
+        }
+        p = *end ? end + 1 : end;
+    }
+    if (*n == 0) goto bad;
+    *out = list;
+    return 0;
+bad:
+    free(list);
+    return -1;
+}
+
+static const struct vm_policy_ops *lookup_policy(const char *name, struct vm_plugin *plugins,
+                                                 int nplugins) {
+    for (int i = 0; i < nplugins; ++i)
+        if (strcmp(plugins[i].ops->name, name) == 0) return plugins[i].ops;
+    return vm_policy_find(name);
+}
+
+static int parse_policies(const char *arg, struct vm_plugin *plugins, int nplugins,
+                          const struct vm_policy_ops **out, int *n) {
+    char *copy = strdup(arg);
+    int rc = copy ? 0 : -1;
+    *n = 0;
+    for (char *save = NULL, *tok = copy ? strtok_r(copy, ",", &save) : NULL;
+         tok && rc == 0; tok = strtok_r(NULL, ",", &save)) {
+        const struct vm_policy_ops *ops = lookup_policy(tok, plugins, nplugins);
+        if (!ops) {
+            fprintf(stderr, "vmsim: unknown policy '%s'\n", tok);
+            rc = -1;
+        } else if (*n == MAX_POLICIES) {
+            fprintf(stderr, "vmsim: too many policies\n");
+            rc = -1;
+        } else {
+            out[(*n)++] = ops;
+        }
+    }
+    free(copy);
+    return rc == 0 && *n > 0 ? 0 : -1;
+}
+
+static void run_job(struct job *j, const struct trace *t, int table_cnt, size_t state_cap) {
+    struct PTE *page_table = calloc((size_t)(table_cnt > 0 ? table_cnt : 1), sizeof(struct PTE));
+    int *frame_pool = malloc(sizeof(int) * (size_t)(j->frames > 0 ? j->frames : 1));
+    if (!page_table || !frame_pool) {
+        j->faults = -1;
+    } else {
+        for (int f = 0; f < j->frames; ++f) frame_pool[f] = f;
+        double start = now_ms();
+        j->faults = vm_policy_run_capped(j->ops, page_table, table_cnt, t->refs, t->count,
+                                         frame_pool, j->frames, state_cap);
+        j->ms = now_ms() - start;
+    }
+    free(page_table);
+    free(frame_pool);
+}
+
+/* Heatmap summary on stdout; the columnar file goes to path */
+static int write_heatmap(const struct vm_heatmap *hm, const char *label, const char *path,
+                         struct vm_heat_thresholds th) {
+    th = vm_heatmap_thresholds(hm, th);
+    int classes[4] = {0, 0, 0, 0};
+    for (int i = 0; i < hm->table_cnt; ++i) classes[vm_heatmap_classify(&hm->pages[i], &th)]++;
+    int rc = vm_heatmap_write(hm, path, &th);
+    if (rc < 0)
+        fprintf(stderr, "vmsim: %s: %s\n", path, strerror(errno));
+    else
+        printf("# heatmap %s -> %s: %d hot (>= %d refs), %d warm, %d cold (<= %d refs)\n",
+               label, path, classes[VM_HEAT_HOT], th.hot_refs, classes[VM_HEAT_WARM],
+               classes[VM_HEAT_COLD], th.cold_refs);
+    return rc;
+}
+
+/* One line per recommended range, largest estimated saving first */
+static int write_advice(const struct vm_heatmap *hm, const struct trace *t, int frames,
+                        const char *label, const char *path, const struct vm_advise_params *ap) {
+    struct vm_advice *adv;
+    int n = vm_advise(hm, t->refs, t->count, frames, ap, &adv);
+    if (n < 0) {
+        fprintf(stderr, "vmsim: advise: out of memory\n");
+        return -1;
+    }
+    FILE *f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "vmsim: %s: %s\n", path, strerror(errno));
+        free(adv);
+        return -1;
+    }
+    fprintf(f, "# advice for %s (estimates from an LRU replay)\n", label);
+    fprintf(f, "%-14s %8s %8s %8s %14s\n", "advice", "start", "end", "pages", "faults_saved");
+    for (int i = 0; i < n; ++i)
+        fprintf(f, "%-14s %8d %8d %8d %14lld\n", vm_advice_name(adv[i].kind), adv[i].start,
+                adv[i].end, adv[i].end - adv[i].start, adv[i].est_fault_reduction);
+    free(adv);
+    int rc = 0;
+    if (f == stdout)
+        fflush(f);
+    else if (fclose(f) != 0)
+        rc = -1;
+    if (rc < 0) fprintf(stderr, "vmsim: %s: %s\n", path, strerror(errno));
+    return rc;
+}
+
+/* Per-page analyses of one run: heatmap file and/or advice */
+static int run_analyses(const struct trace *t, int table_cnt, const struct vm_policy_ops *ops,
+                        int frames, const char *heatmap_path, const char *advise_path,
+                        const struct vm_advise_params *ap) {
+    struct vm_heatmap hm;
+    if (vm_heatmap_init(&hm, table_cnt) < 0 ||
+        vm_heatmap_collect(&hm, ops, t->refs, t->count, frames) < 0) {
+        fprintf(stderr, "vmsim: heatmap: out of memory\n");
+        vm_heatmap_free(&hm);
+        return -1;
+    }
+    char label[64];
+    snprintf(label, sizeof(label), "%s/%d", ops->name, frames);
+    int rc = 0;
+    if (heatmap_path && write_heatmap(&hm, label, heatmap_path, ap->th) < 0) rc = -1;
+    if (advise_path && write_advice(&hm, t, frames, label, advise_path, ap) < 0) rc = -1;
+    vm_heatmap_free(&hm);
+    return rc;
+}
+
+/* Phase timeline of the trace, then faults per phase for every policy */
+static int run_phases(const struct trace *t, int table_cnt, const struct vm_policy_ops **policies,
+                      int npolicies, int frames, int interval, double threshold) {
+    struct PTE *page_table = calloc((size_t)(table_cnt > 0 ? table_cnt : 1), sizeof(struct PTE));
+    int *frame_pool = malloc(sizeof(int) * (size_t)(frames > 0 ? frames : 1));
+    int rc = page_table && frame_pool ? 0 : -1;
+
+    for (int p = 0; rc == 0 && p < npolicies; ++p) {
+        struct vm_phase_tracker pt;
+        struct vm_observer obs;
+        vm_phase_init(&pt, interval, threshold);
+        vm_phase_observer(&pt, &obs);
+        memset(page_table, 0, sizeof(struct PTE) * (size_t)table_cnt);
+        for (int f = 0; f < frames; ++f) frame_pool[f] = f;
+        if (vm_policy_run_observed(policies[p], page_table, table_cnt, t->refs, t->count,
+                                   frame_pool, frames, &obs) < 0 ||
+            vm_phase_finish(&pt) < 0) {
+            vm_phase_free(&pt);
+            rc = -1;
+            break;
+        }
+        if (p == 0) {
+            /* detection only sees pages, so the timeline is the same for every policy */
+            printf("# phases: %d references per interval, distance > %.2f, %d phases\n",
+                   interval, threshold, pt.nphases);
+            for (int i = 0; i < pt.ntimeline;) {
+                int j = i;
+                while (j < pt.ntimeline && pt.timeline[j] == pt.timeline[i]) j++;
+                long long last = (long long)j * interval < t->count ? (long long)j * interval
+                                                                   : t->count;
+                printf("#   phase %-3d references %lld-%lld\n", pt.timeline[i],
+                       (long long)i * interval + 1, last);
+                i = j;
+            }
+            printf("%-10s %8s %6s %10s %12s %12s %10s\n", "policy", "frames", "phase",
+                   "intervals", "references", "faults", "hit_ratio");
+        }
+        for (int i = 0; i < pt.nphases; ++i) {
+            const struct vm_phase *ph = &pt.phases[i];
+            double hit = ph->references ? 1.0 - (double)ph->faults / ph->references : 0.0;
+            printf("%-10s %8d %6d %10d %12lld %12lld %10.4f\n", policies[p]->name, frames, i,
+                   ph->intervals, ph->references, ph->faults, hit);
+        }
+        vm_phase_free(&pt);
+    }
+    if (rc < 0) fprintf(stderr, "vmsim: phases: out of memory\n");
+    free(page_table);
+    free(frame_pool);
+    return rc;
+}
+
+/* Every policy under the cgroup limits, one row each */
+static int run_cgroup(const struct trace *t, int table_cnt, const struct vm_policy_ops **policies,
+                      int npolicies, int frames, const struct vm_cgroup_limits *lim) {
+    struct PTE *page_table = calloc((size_t)(table_cnt > 0 ? table_cnt : 1), sizeof(struct PTE));
+    int *frame_pool = malloc(sizeof(int) * (size_t)(frames > 0 ? frames : 1));
+    if (!page_table || !frame_pool) {
+        fprintf(stderr, "vmsim: cgroup: out of memory\n");
+        free(page_table);
+        free(frame_pool);
+        return -1;
+    }
+    printf("# cgroup: memory.high %d, memory.max %d pages (0: unlimited)\n", lim->high, lim->max);
+    printf("%-10s %8s %12s %8s %10s %12s %10s %12s %12s %12s\n", "policy", "frames", "faults",
+           "peak", "high_evts", "high_pages", "max_evts", "max_pages", "throttle_ms", "stall_ms");
+    int rc = 0;
+    for (int p = 0; p < npolicies; ++p) {
+        struct vm_cgroup_stats st;
+        memset(page_table, 0, sizeof(struct PTE) * (size_t)table_cnt);
+        for (int f = 0; f < frames; ++f) frame_pool[f] = f;
+        if (vm_cgroup_run(policies[p], page_table, table_cnt, t->refs, t->count, frame_pool,
+                          frames, lim, &st) < 0) {
+            printf("%-10s %8d %12s\n", policies[p]->name, frames, "error");
+            rc = -1;
+            continue;
+        }
+        printf("%-10s %8d %12d %8d %10lld %12lld %10lld %12lld %12.3f %12.3f\n",
+               policies[p]->name, frames, st.faults, st.peak, st.high_events, st.high_reclaimed,
+               st.max_events, st.max_reclaimed, st.throttle_us / 1e3, st.stall_us / 1e3);
+    }
+    free(page_table);
+    free(frame_pool);
+    return rc;
+}
+
+/* Direct against background reclaim for every policy, one row each */
+static int run_kswapd(const struct trace *t, int table_cnt, const struct vm_policy_ops **policies,
+                      int npolicies, int frames, const struct vm_kswapd_params *kp) {
+    struct PTE *page_table = calloc((size_t)(table_cnt > 0 ? table_cnt : 1), sizeof(struct PTE));
+    int *frame_pool = malloc(sizeof(int) * (size_t)(frames > 0 ? frames : 1));
+    if (!page_table || !frame_pool) {
+        fprintf(stderr, "vmsim: kswapd: out of memory\n");
+        free(page_table);
+        free(frame_pool);
+        return -1;
+    }
+    printf("# kswapd: watermarks min %d, low %d, high %d free frames, %.2f pages per reference\n",
+           kp->min, kp->low, kp->high, kp->rate);
+    printf("%-10s %8s %12s %12s %12s %12s %10s %10s\n", "policy", "frames", "faults",
+           "direct", "direct_pages", "bg_pages", "wakeups", "refaults");
+    int rc = 0;
+    for (int p = 0; p < npolicies; ++p) {
+        struct vm_kswapd_stats st;
+        memset(page_table, 0, sizeof(struct PTE) * (size_t)table_cnt);
+        for (int f = 0; f < frames; ++f) frame_pool[f] = f;
+        if (vm_kswapd_run(policies[p], page_table, table_cnt, t->refs, t->count, frame_pool,
+                          frames, kp, &st) < 0) {
+            printf("%-10s %8d %12s\n", policies[p]->name, frames, "error");
+            rc = -1;
+            continue;
+        }
+        printf("%-10s %8d %12d %12lld %12lld %12lld %10lld %10lld\n", policies[p]->name, frames,
+               st.faults, st.direct_stalls, st.direct_reclaimed, st.background_reclaimed,
+               st.wakeups, st.refaults);
+    }
+    free(page_table);
+    free(frame_pool);
+    return rc;
+}
+
+/* Latency percentiles for every policy, one row each */
+static int run_latency(const struct trace *t, int table_cnt, const struct vm_policy_ops **policies,
+                       int npolicies, int frames, const struct vm_latency_costs *costs) {
+    struct PTE *page_table = calloc((size_t)(table_cnt > 0 ? table_cnt : 1), sizeof(struct PTE));
+    int *frame_pool = malloc(sizeof(int) * (size_t)(frames > 0 ? frames : 1));
+    struct vm_hdr *h = malloc(sizeof(*h));
+    int rc = 0;
+    if (!page_table || !frame_pool || !h) {
+        fprintf(stderr, "vmsim: latency: out of memory\n");
+        rc = -1;
+        goto done;
+    }
+    printf("# latency: hit %llu, walk %llu, fault %llu, reclaim %llu ns, %d TLB entries\n",
+           (unsigned long long)costs->hit, (unsigned long long)costs->walk,
+           (unsigned long long)costs->fault, (unsigned long long)costs->reclaim,
+           costs->tlb_entries);
+    printf("%-10s %8s %10s %10s %10s %10s %10s %10s\n", "policy", "frames", "mean_ns", "p50_ns",
+           "p99_ns", "p99.9_ns", "max_ns", "total_ms");
+    for (int p = 0; p < npolicies; ++p) {
+        memset(page_table, 0, sizeof(struct PTE) * (size_t)table_cnt);
+        for (int f = 0; f < frames; ++f) frame_pool[f] = f;
+        vm_hdr_init(h);
+        if (vm_latency_run(policies[p], page_table, table_cnt, t->refs, t->count, frame_pool,
+                           frames, costs, h) < 0) {
+            printf("%-10s %8d %10s\n", policies[p]->name, frames, "error");
+            rc = -1;
+            continue;
+        }
+        printf("%-10s %8d %10.1f %10llu %10llu %10llu %10llu %10.3f\n", policies[p]->name, frames,
+               h->total ? h->sum / (double)h->total : 0.0,
+               (unsigned long long)vm_hdr_quantile(h, 0.5),
+               (unsigned long long)vm_hdr_quantile(h, 0.99),
+               (unsigned long long)vm_hdr_quantile(h, 0.999), (unsigned long long)h->max,
+               h->sum / 1e6);
+    }
+done:
+    free(h);
+    free(page_table);
+    free(frame_pool);
+    return rc;
+}
+
+/* Faults for every frame count from one stack-distance pass per policy */
+static int run_stack_distance(const struct trace *t, int table_cnt, const char *list,
+                              const int *frames, int nframes) {
+    char *names = strdup(list);
+    if (!names) return -1;
+    int rc = 0;
+    int header = 0;
+    for (char *save, *name = strtok_r(names, ",", &save); name; name = strtok_r(NULL, ",", &save)) {
+        int kind = vm_stack_kind(name);
+        if (kind < 0) {
+            printf("# %s: not a stack algorithm, every frame count needs a full replay\n", name);
+            continue;
+        }
+        struct vm_stack_profile sp;
+        double start = now_ms();
+        if (vm_stack_profile_build(&sp, kind, t->refs, t->count, table_cnt) < 0) {
+            fprintf(stderr, "vmsim: stack distance: out of memory\n");
+            rc = -1;
+            continue;
+        }
+        double built = now_ms();
+        if (!header) {
+            printf("%-10s %8s %12s %10s %12s\n", "stack", "frames", "faults", "hit_ratio",
+                   "query_us");
+            header = 1;
+        }
+        for (int f = 0; f < nframes; ++f) {
+            double q = now_ms();
+            long long faults = vm_stack_faults(&sp, frames[f]);
+            q = now_ms() - q;
+            double hit = t->count ? 1.0 - (double)faults / t->count : 0.0;
+            printf("%-10s %8d %12lld %10.4f %12.3f\n", name, frames[f], faults, hit, q * 1e3);
+        }
+        printf("# %s: profile built in %.3f ms, max depth %d\n", name, built - start,
+               sp.max_depth);
+        vm_stack_profile_free(&sp);
+    }
+    free(names);
+    return rc;
+}
+
+/* FIFO faults over the frame list; every increase is shrunk and reported */
+static int run_belady(const struct trace *t, int table_cnt, const int *frames, int nframes,
+                      int nthreads) {
+    long long *faults = malloc(sizeof(long long) * (size_t)(nframes > 0 ? nframes : 1));
+    int *sorted = malloc(sizeof(int) * (size_t)(nframes > 0 ? nframes : 1));
+    if (!faults || !sorted) {
+        free(faults);
+        free(sorted);
+        fprintf(stderr, "vmsim: belady: out of memory\n");
+        return -1;
+    }
+    /* the frame list is ascending by construction, but be safe with user order */
+    memcpy(sorted, frames, sizeof(int) * (size_t)nframes);
+    for (int i = 1; i < nframes; ++i)
+        for (int j = i; j > 0 && sorted[j - 1] > sorted[j]; --j) {
+            int tmp = sorted[j];
+            sorted[j] = sorted[j - 1];
+            sorted[j - 1] = tmp;
+        }
+    double start = now_ms();
+    int rc = vm_fifo_sweep(t->refs, t->count, table_cnt, sorted, nframes, nthreads, faults);
+    double ms = now_ms() - start;
+    if (rc < 0) fprintf(stderr, "vmsim: belady: out of memory\n");
+    int found = 0;
+    for (int i = 1; rc == 0 && i < nframes; ++i) {
+        if (faults[i] <= faults[i - 1] || sorted[i] == sorted[i - 1]) continue;
+        struct vm_anomaly a = { sorted[i - 1], sorted[i], faults[i - 1], faults[i], NULL, 0, 0, 0 };
+        printf("# belady: %d frames %lld faults, %d frames %lld faults\n", a.small,
+               a.small_faults, a.large, a.large_faults);
+        if (vm_belady_shrink(t->refs, t->count, table_cnt, &a) < 0) {
+            fprintf(stderr, "vmsim: belady: out of memory\n");
+            rc = -1;
+            break;
+        }
+        printf("#   reproducer at %d/%d frames, %d references:", a.repro_small, a.repro_large,
+               a.reference_cnt);
+        for (int k = 0; k < a.reference_cnt; ++k) printf(" %d", a.refs[k]);
+        printf("\n");
+        free(a.refs);
+        found++;
+    }
+    if (rc == 0)
+        printf("# belady: %d frame counts scanned in %.3f ms, %d anomalies\n", nframes, ms, found);
+    free(faults);
+    free(sorted);
+    return rc;
+}
+
+/* Faults and waste at every page size, from one pass over the addresses */
+static int run_page_sizes(const char *path, const char *list, int frames) {
+    struct vm_pagesize_result res[VM_PAGESIZE_MAX];
+    int nsizes = 0;
+    char *names = strdup(list);
+    if (!names) return -1;
+    int rc = 0;
+    for (char *save, *tok = strtok_r(names, ",", &save); tok && rc == 0;
+         tok = strtok_r(NULL, ",", &save)) {
+        size_t size;
+        if (parse_size(tok, &size) < 0 || size < 64 || (size & (size - 1)) ||
+            nsizes == VM_PAGESIZE_MAX) {
+            fprintf(stderr, "vmsim: bad page size '%s' (powers of two from 64, at most %d)\n",
+                    tok, VM_PAGESIZE_MAX);
+            rc = -1;
+            break;
+        }
+        res[nsizes++].shift = (unsigned int)__builtin_ctzll(size);
+    }
+    free(names);
+    if (rc < 0 || nsizes == 0) return -1;
+
+    unsigned int smallest = res[0].shift;
+    for (int k = 1; k < nsizes; ++k)
+        if (res[k].shift < smallest) smallest = res[k].shift;
+    uint64_t mem = (uint64_t)frames << smallest;
+
+    uint64_t *addrs;
+    long long n;
+    if (load_values(path, "address", &addrs, &n) < 0) return -1;
+    uint64_t touched;
+    double start = now_ms();
+    rc = vm_pagesize_run(addrs, n, mem, res, nsizes, &touched);
+    double ms = now_ms() - start;
+    free(addrs);
+    if (rc < 0) {
+        fprintf(stderr, "vmsim: page-sizes: out of memory\n");
+        return -1;
+    }
+    printf("# page sizes: %lld addresses, %.1f KB memory, %.1f KB touched, %.3f ms\n", n,
+           mem / 1024.0, touched / 1024.0, ms);
+    printf("%-10s %8s %12s %10s %10s %12s %8s\n", "page_size", "frames", "faults", "hit_ratio",
+           "pages", "waste_kb", "waste%");
+    for (int k = 0; k < nsizes; ++k) {
+        const struct vm_pagesize_result *r = &res[k];
+        char name[16];
+        uint64_t size = 1ull << r->shift;
+        if (size >= (1ull << 20)) snprintf(name, sizeof(name), "%lluM", (unsigned long long)(size >> 20));
+        else if (size >= 1024) snprintf(name, sizeof(name), "%lluK", (unsigned long long)(size >> 10));
+        else snprintf(name, sizeof(name), "%llu", (unsigned long long)size);
+        printf("%-10s %8d %12lld %10.4f %10lld %12.1f %8.1f\n", name, r->frames, r->faults,
+               n ? 1.0 - (double)r->faults / (double)n : 0.0, r->pages, r->waste / 1024.0,
+               r->footprint ? 100.0 * (double)r->waste / (double)r->footprint : 0.0);
+    }
+    return 0;
+}
+
+/* Huge page coverage and buddy fragmentation for the FIFO and LRU policies */
+static int run_thp(const struct trace *t, int table_cnt, const struct vm_policy_ops **policies,
+                   int npolicies, int frames, int huge_pages,
+                   const struct vm_thp_params *params) {
+    static const char *const modes[] = { "no", "direct", "background" };
+    struct PTE *page_table = calloc((size_t)(table_cnt > 0 ? table_cnt : 1), sizeof(struct PTE));
+    if (!page_table) {
+        fprintf(stderr, "vmsim: thp: out of memory\n");
+        return -1;
+    }
+    struct vm_thp_params p = *params;
+    p.huge_order = __builtin_ctz((unsigned int)huge_pages);
+    int rc = 0;
+    printf("# thp: %d pages per huge page, buddy allocator over %d frames, %s compaction\n",
+           huge_pages, frames, modes[p.compact]);
+    printf("%-10s %8s %10s %10s %10s %10s %10s %10s %12s %10s %10s\n", "policy", "frames",
+           "faults", "huge", "fb_nomem", "fb_frag", "huge_ref%", "unusable", "compact_pgs",
+           "compacts", "migrated");
+    for (int i = 0; i < npolicies; ++i) {
+        const char *name = policies[i]->name;
+        if (strcmp(name, "fifo") != 0 && strcmp(name, "lru") != 0) {
+            printf("%-10s %8d %10s\n", name, frames, "-");
+            continue;
+        }
+        p.lru = strcmp(name, "lru") == 0;
+        struct vm_thp_stats st;
+        memset(page_table, 0, sizeof(struct PTE) * (size_t)table_cnt);
+        if (vm_thp_run(page_table, table_cnt, t->refs, t->count, frames, &p, &st) < 0) {
+            printf("%-10s %8d %10s\n", name, frames, "error");
+            rc = -1;
+            continue;
+        }
+        printf("%-10s %8d %10lld %10lld %10lld %10lld %10.1f %10.3f %12lld %10lld %10lld\n",
+               name, frames, st.faults, st.huge_faults, st.fallback_nomem, st.fallback_frag,
+               t->count ? 100.0 * (double)st.huge_refs / t->count : 0.0,
+               st.fallback_frag ? st.unusable_sum / (double)st.fallback_frag : 0.0,
+               st.compact_cost, st.compact_runs - st.compact_fail, st.pages_migrated);
+    }
+    free(page_table);
+    return rc;
+}
+
+/* Frames saved by merging and the COW faults it costs, for FIFO and LRU */
+static int run_ksm(const struct trace *t, int table_cnt, const struct vm_policy_ops **policies,
+                   int npolicies, int frames, const char *path, const struct vm_ksm_params *params) {
+    uint64_t *content;
+    long long n;
+    if (load_values(path, "content hash", &content, &n) < 0) return -1;
+    if (n != t->count) {
+        fprintf(stderr, "vmsim: %s: %lld content hashes for %d references\n", path, n, t->count);
+        free(content);
+        return -1;
+    }
+    struct PTE *page_table = calloc((size_t)(table_cnt > 0 ? table_cnt : 1), sizeof(struct PTE));
+    if (!page_table) {
+        fprintf(stderr, "vmsim: ksm: out of memory\n");
+        free(content);
+        return -1;
+    }
+    struct vm_ksm_params p = *params;
+    int rc = 0;
+    printf("# ksm: scan %d frames every %d references\n", p.pages_to_scan, p.scan_interval);
+    printf("%-10s %8s %10s %10s %10s %10s %10s %10s\n", "policy", "frames", "faults", "cow",
+           "merged", "mean_saved", "peak_saved", "saved");
+    for (int i = 0; i < npolicies; ++i) {
+        const char *name = policies[i]->name;
+        if (strcmp(name, "fifo") != 0 && strcmp(name, "lru") != 0) {
+            printf("%-10s %8d %10s\n", name, frames, "-");
+            continue;
+        }
+        p.lru = strcmp(name, "lru") == 0;
+        struct vm_ksm_stats st;
+        memset(page_table, 0, sizeof(struct PTE) * (size_t)table_cnt);
+        if (vm_ksm_run(page_table, table_cnt, t->refs, content, t->count, frames, &p, &st) < 0) {
+            printf("%-10s %8d %10s\n", name, frames, "error");
+            rc = -1;
+            continue;
+        }
+        printf("%-10s %8d %10lld %10lld %10lld %10.1f %10d %10d\n", name, frames, st.faults,
+               st.cow_faults, st.merged, t->count ? st.saved_sum / t->count : 0.0,
+               st.peak_saved, st.saved);
+    }
+    free(page_table);
+    free(content);
+    return rc;
+}
+
+/* Each policy as a guest on a host that may hold fewer frames than it */
+static int run_nested(const struct trace *t, int table_cnt, const struct vm_policy_ops **policies,
+                      int npolicies, int frames, const struct vm_policy_ops *host,
+                      int host_frames, int tlb_entries) {
+    struct PTE *page_table = calloc((size_t)(table_cnt > 0 ? table_cnt : 1), sizeof(struct PTE));
+    if (!page_table) {
+        fprintf(stderr, "vmsim: nested: out of memory\n");
+        return -1;
+    }
+    struct vm_nested_params p;
+    vm_nested_defaults(&p);
+    p.tlb_entries = tlb_entries;
+    int rc = 0;
+    printf("# nested: host %s, %d frames; %d-level guest and %d-level host tables, %d TLB entries\n",
+           host->name, host_frames, p.guest_levels, p.host_levels, p.tlb_entries);
+    printf("%-10s %8s %10s %10s %10s %10s %10s %10s\n", "policy", "frames", "guest", "host",
+           "double", "tlb_miss", "walk_2d", "walk_1d");
+    for (int i = 0; i < npolicies; ++i) {
+        const char *name = policies[i]->name;
+        struct vm_nested_stats st;
+        memset(page_table, 0, sizeof(struct PTE) * (size_t)table_cnt);
+        if (vm_nested_run(policies[i], page_table, table_cnt, frames, host, host_frames,
+                          t->refs, t->count, &p, &st) < 0) {
+            printf("%-10s %8d %10s\n", name, frames, "error");
+            rc = -1;
+            continue;
+        }
+        printf("%-10s %8d %10lld %10lld %10lld %10lld %10lld %10lld\n", name, frames,
+               st.guest_faults, st.host_faults, st.double_paging, st.tlb_misses, st.walk_refs,
+               st.native_walk_refs);
+    }
+    free(page_table);
+    return rc;
+}
+
+/* Host swap against ballooning for several guests overcommitting one host.
+ * Guest g replays the trace rotated by g / guests of its length, so the
+ * guests' working sets shift out of step. */
+static int run_balloon(const struct trace *t, int table_cnt, const struct vm_policy_ops **policies,
+                       int npolicies, int frames, int guests, const struct vm_policy_ops *host,
+                       int host_frames, const struct vm_latency_costs *costs,
+                       const struct vm_balloon_params *params) {
+    size_t n = (size_t)(t->count > 0 ? t->count : 1);
+    int *copies = malloc(sizeof(int) * n * (size_t)guests);
+    const int **refs = malloc(sizeof(*refs) * (size_t)guests);
+    struct vm_hdr *h = malloc(sizeof(*h));
+    int rc = 0;
+    if (!copies || !refs || !h) {
+        fprintf(stderr, "vmsim: balloon: out of memory\n");
+        rc = -1;
+        goto done;
+    }
+    for (int g = 0; g < guests; ++g) {
+        int *r = copies + n * (size_t)g;
+        int shift = (int)((long long)t->count * g / guests);
+        for (int i = 0; i < t->count; ++i) r[i] = t->refs[(i + shift) % t->count];
+        refs[g] = r;
+    }
+    printf("# balloon: %d guests of %d frames on %d host frames; host swap under %s, "
+           "balloons move %d frames every %d rounds\n", guests, frames, host_frames, host->name,
+           params->step, params->interval);
+    printf("%-10s %8s %10s %10s %10s %10s %10s %10s %10s\n", "policy", "mode", "guest", "host",
+           "double", "ballooned", "mean_ns", "p99_ns", "total_ms");
+    for (int i = 0; i < npolicies; ++i) {
+        const char *name = policies[i]->name;
+        for (int m = 0; m < 2; ++m) {
+            struct vm_balloon_params p = *params;
+            struct vm_balloon_stats st;
+            p.mode = m ? VM_OVERCOMMIT_BALLOON : VM_OVERCOMMIT_SWAP;
+            const char *mode = m ? "balloon" : "swap";
+            vm_hdr_init(h);
+            if (vm_balloon_run(policies[i], refs, guests, t->count, table_cnt, frames, host,
+                               host_frames, costs, &p, h, &st) < 0) {
+                printf("%-10s %8s %10s\n", name, mode, "error");
+                rc = -1;
+                continue;
+            }
+            printf("%-10s %8s %10lld %10lld %10lld %10lld %10.1f %10llu %10.3f\n", name, mode,
+                   st.guest_faults, st.host_faults, st.double_paging, st.ballooned,
+                   h->total ? h->sum / (double)h->total : 0.0,
+                   (unsigned long long)vm_hdr_quantile(h, 0.99), (h->sum + st.inflate_ns) / 1e6);
+        }
+    }
+done:
+    free(h);
+    free(refs);
+    free(copies);
+    return rc;
+}
+
+/* Victim scans over frames against scans over the whole page table. Both
+ * sides count pages beyond a short -t as faults, so they still agree. */
+static int run_frame_table(const struct trace *t, int table_cnt,
+                           const struct vm_policy_ops **policies, int npolicies, int frames) {
+    static const struct {
+        const char *name;
+        int (*scan)(struct PTE *, int, int *, int, int *, int);
+        int (*inverted)(struct PTE *, int, int *, int, int *, int);
+    } pairs[] = {
+        { "fifo", count_page_faults_fifo, count_page_faults_fifo_frames },
+        { "lru", count_page_faults_lru, count_page_faults_lru_frames },
+        { "lfu", count_page_faults_lfu, count_page_faults_lfu_frames },
+    };
+    struct PTE *page_table = calloc((size_t)(table_cnt > 0 ? table_cnt : 1), sizeof(struct PTE));
+    int *frame_pool = malloc(sizeof(int) * (size_t)(frames > 0 ? frames : 1));
+    int rc = 0;
+    if (!page_table || !frame_pool) {
+        fprintf(stderr, "vmsim: frame-table: out of memory\n");
+        rc = -1;
+        goto done;
+    }
+    printf("# frame-table: %d frames against a %d-entry page table\n", frames, table_cnt);
+    printf("%-10s %8s %10s %10s %10s\n", "policy", "frames", "faults", "scan_ms", "frames_ms");
+    for (int i = 0; i < npolicies; ++i) {
+        const char *name = policies[i]->name;
+        int k = 0;
+        while (k < 3 && strcmp(name, pairs[k].name) != 0) k++;
+        if (k == 3) {
+            printf("%-10s %8d %10s\n", name, frames, "-");
+            continue;
+        }
+        int faults[2];
+        double ms[2];
+        for (int v = 0; v < 2; ++v) {
+            memset(page_table, 0, sizeof(struct PTE) * (size_t)table_cnt);
+            for (int f = 0; f < frames; ++f) frame_pool[f] = f;
+            double start = now_ms();
+            faults[v] = (v ? pairs[k].inverted : pairs[k].scan)(page_table, table_cnt, t->refs,
+                                                                 t->count, frame_pool, frames);
+            ms[v] = now_ms() - start;
+        }
+        if (faults[0] < 0 || faults[1] < 0 || faults[0] != faults[1]) {
+            printf("%-10s %8d %10s\n", name, frames, "error");
+            rc = -1;
+            continue;
+        }
+        printf("%-10s %8d %10d %10.3f %10.3f\n", name, frames, faults[1], ms[0], ms[1]);
+    }
+done:
+    free(page_table);
+    free(frame_pool);
+    return rc;
+}
+
+/* LRU through the hashed page table, against the flat table's footprint */
+static int run_hashed_pt(const struct trace *t, int table_cnt, int frames) {
+    struct vm_hpt h;
+    if (vm_hpt_init(&h, 1) < 0) {
+        fprintf(stderr, "vmsim: hashed-pt: out of memory\n");
+        return -1;
+    }
+    double start = now_ms();
+    int faults = vm_hpt_lru_run(&h, t->refs, NULL, t->count, frames);
+    double ms = now_ms() - start;
+    if (faults < 0) {
+        fprintf(stderr, "vmsim: hashed-pt: out of memory\n");
+        vm_hpt_free(&h);
+        return -1;
+    }
+    const struct vm_hpt_stats *st = &h.stats;
+    size_t bytes = (size_t)(h.cur.nbuckets + h.old.nbuckets) * VM_BUCKET_SLOTS *
+                   (sizeof(uint64_t) + sizeof(int));
+    printf("# hashed-pt: lru, %d frames: %d faults in %.3f ms, %.2f probes/lookup, %lld kicks, "
+           "%lld resizes, %lld rebuilds, peak load %.2f\n",
+           frames, faults, ms, st->lookups ? (double)st->probes / (double)st->lookups : 0.0,
+           st->kicks, st->resizes, st->rebuilds, st->peak_load);
+    printf("# hashed-pt: %.1f KB of buckets, %.1f KB flat page table\n", bytes / 1024.0,
+           (double)table_cnt * sizeof(struct PTE) / 1024.0);
+    vm_hpt_free(&h);
+    return 0;
+}
+
+static void *worker(void *arg) {
+    struct job_queue *q = arg;
+    pthread_mutex_lock(&q->lock);
+    for (;;) {
+        if (q->next >= q->njobs) break;
+        struct job *j = &q->jobs[q->next];
+        /* a job larger than the whole budget still runs, alone */
+        if (q->in_use && q->in_use + j->bytes > q->budget) {
+            pthread_cond_wait(&q->room, &q->lock);
+            continue;
+        }
+        q->next++;
+        q->in_use += j->bytes;
+        pthread_mutex_unlock(&q->lock);
+
+        run_job(j, q->trace, q->table_cnt, q->state_cap);
+
+        pthread_mutex_lock(&q->lock);
+        q->in_use -= j->bytes;
+        pthread_cond_broadcast(&q->room);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+
+/* Run the queue on nthreads workers; the caller's thread is one of them */
+static void run_jobs(struct job_queue *q, int nthreads) {
+    pthread_t tids[256];
+    int started = 0;
+    if (nthreads > q->njobs) nthreads = q->njobs;
+    if (nthreads > 256) nthreads = 256;
+    for (int i = 1; i < nthreads; ++i)
+        if (pthread_create(&tids[started], NULL, worker, q) == 0) started++;
+    worker(q);
+    for (int i = 0; i < started; ++i) pthread_join(tids[i], NULL);
+}
+
+int main(int argc, char **argv) {
+    static const struct option long_opts[] = {
+        {"policies", required_argument, NULL, 'p'},
+        {"frames", required_argument, NULL, 'f'},
+        {"table-size", required_argument, NULL, 't'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"plugin", required_argument, NULL, 'P'},
+        {"help", no_argument, NULL, 'h'},
+        {"heatmap", required_argument, NULL, OPT_HEATMAP},
+        {"hot", required_argument, NULL, OPT_HOT},
+        {"cold", required_argument, NULL, OPT_COLD},
+        {"advise", required_argument, NULL, OPT_ADVISE},
+        {"huge-pages", required_argument, NULL, OPT_HUGE_PAGES},
+        {"phases", required_argument, NULL, OPT_PHASES},
+        {"phase-threshold", required_argument, NULL, OPT_PHASE_THRESHOLD},
+        {"memory-high", required_argument, NULL, OPT_MEMORY_HIGH},
+        {"memory-max", required_argument, NULL, OPT_MEMORY_MAX},
+        {"watermarks", required_argument, NULL, OPT_WATERMARKS},
+        {"kswapd-rate", required_argument, NULL, OPT_KSWAPD_RATE},
+        {"latency", no_argument, NULL, OPT_LATENCY},
+        {"latency-costs", required_argument, NULL, OPT_LATENCY_COSTS},
+        {"mem-budget", required_argument, NULL, OPT_MEM_BUDGET},
+        {"state-cap", required_argument, NULL, OPT_STATE_CAP},
+        {"stack-distance", required_argument, NULL, OPT_STACK_DISTANCE},
+        {"belady", no_argument, NULL, OPT_BELADY},
+        {"frame-table", no_argument, NULL, OPT_FRAME_TABLE},
+        {"hashed-pt", no_argument, NULL, OPT_HASHED_PT},
+        {"page-sizes", required_argument, NULL, OPT_PAGE_SIZES},
+        {"thp", no_argument, NULL, OPT_THP},
+        {"compaction", required_argument, NULL, OPT_COMPACTION},
+        {"ksm", required_argument, NULL, OPT_KSM},
+        {"ksm-scan", required_argument, NULL, OPT_KSM_SCAN},
+        {"nested", required_argument, NULL, OPT_NESTED},
+        {"balloon", required_argument, NULL, OPT_BALLOON},
+        {"balloon-adjust", required_argument, NULL, OPT_BALLOON_ADJUST},
+        {NULL, 0, NULL, 0}
+    };
+    const char *policy_arg = "fifo,lru,lfu";
+    const char *frames_arg = "4";
+    int table_cnt = -1;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = ncpu > 0 ? (int)ncpu : 1;
+    struct vm_plugin plugins[MAX_PLUGINS];
+    int nplugins = 0;
+    const char *heatmap_path = NULL;
+    const char *advise_path = NULL;
+    struct vm_advise_params advise;
+    vm_advise_defaults(&advise);
+    int phase_interval = 0;
+    double phase_threshold = 0.5;
+    struct vm_cgroup_limits cgroup;
+    vm_cgroup_defaults(&cgroup);
+    struct vm_kswapd_params kswapd = { 0, -1, -1, 1.0 };
+    int latency = 0;
+    size_t mem_budget = SIZE_MAX;
+    size_t state_cap = SIZE_MAX;
+    const char *stack_list = NULL;
+    int belady = 0;
+    int frame_table = 0;
+    int hashed_pt = 0;
+    const char *page_sizes = NULL;
+    int thp = 0;
+    struct vm_thp_params thp_params = { 0, 0, VM_COMPACT_NONE, 1000, 0 };
+    const char *ksm_path = NULL;
+    struct vm_ksm_params ksm;
+    vm_ksm_defaults(&ksm);
+    const char *nested_arg = NULL;
+    const char *balloon_arg = NULL;
+    struct vm_balloon_params balloon;
+    vm_balloon_defaults(&balloon);
+    struct vm_latency_costs costs;
+    vm_latency_defaults(&costs);
+    int status = 1;
+    char *end;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "p:f:t:j:P:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'p':
+            policy_arg = optarg;
+            break;
+        case 'f':
+            frames_arg = optarg;
+            break;
+        case 't':
+            if (parse_int(optarg, &end, &table_cnt) < 0 || *end) {
+                fprintf(stderr, "vmsim: bad table size '%s'\n", optarg);
+                goto out;
+            }
+            break;
+        case 'j':
+            if (parse_int(optarg, &end, &nthreads) < 0 || *end || nthreads < 1) {
+                fprintf(stderr, "vmsim: bad job count '%s'\n", optarg);
+                goto out;
+            }
+            break;
+        case 'P':
+            if (nplugins == MAX_PLUGINS) {
+                fprintf(stderr, "vmsim: too many plugins\n");
+                goto out;
+            }
+            if (vm_plugin_load(&plugins[nplugins], optarg) < 0) {
+                fprintf(stderr, "vmsim: %s: %s\n", optarg, plugins[nplugins].error);
+                goto out;
+            }
+            nplugins++;
+            break;
+        case OPT_HEATMAP:
+            heatmap_path = optarg;
+            break;
+        case OPT_HOT:
+        case OPT_COLD:
+            if (parse_int(optarg, &end, opt == OPT_HOT ? &advise.th.hot_refs : &advise.th.cold_refs) < 0 ||
+                *end) {
+                fprintf(stderr, "vmsim: bad threshold '%s'\n", optarg);
+                goto out;
+            }
+            break;
+        case OPT_ADVISE:
+            advise_path = optarg;
+            break;
+        case OPT_HUGE_PAGES:
+            if (parse_int(optarg, &end, &advise.huge_pages) < 0 || *end || advise.huge_pages < 1) {
+                fprintf(stderr, "vmsim: bad huge page size '%s'\n", optarg);
+                goto out;
+            }
+            break;
+        case OPT_PHASES:
+            if (parse_int(optarg, &end, &phase_interval) < 0 || *end || phase_interval < 1) {
+                fprintf(stderr, "vmsim: bad phase interval '%s'\n", optarg);
+                goto out;
+            }
+            break;
+        case OPT_PHASE_THRESHOLD:
+            errno = 0;
+            phase_threshold = strtod(optarg, &end);
+            if (end == optarg || *end || errno || phase_threshold < 0 || phase_threshold > 1) {
+                fprintf(stderr, "vmsim: bad phase threshold '%s'\n", optarg);
+                goto out;
+            }
+            break;
+        case OPT_MEMORY_HIGH:
+        case OPT_MEMORY_MAX:
+            if (parse_int(optarg, &end, opt == OPT_MEMORY_HIGH ? &cgroup.high : &cgroup.max) < 0 ||
+                *end) {
+                fprintf(stderr, "vmsim: bad memory limit '%s'\n", optarg);
+                goto out;
+            }
+            break;
+        case OPT_WATERMARKS:
+            kswapd.min = 0;
+            if (parse_int(optarg, &end, &kswapd.low) < 0 || *end != ',' ||
+                parse_int(end + 1, &end, &kswapd.high) < 0 ||
+                (*end == ',' && parse_int(end + 1, &end, &kswapd.min) < 0) || *end ||
+                kswapd.high < kswapd.low || kswapd.low < kswapd.min) {
+                fprintf(stderr, "vmsim: bad watermarks '%s'\n", optarg);
+                goto out;
+            }
+            break;
+        case OPT_KSWAPD_RATE:
+            errno = 0;
+            kswapd.rate = strtod(optarg, &end);
+            if (end == optarg || *end || errno || kswapd.rate <= 0) {
+                fprintf(stderr, "vmsim: bad reclaim rate '%s'\n", optarg);
+                goto out;
+            }
+            if (kswapd.low < 0) kswapd.low = 0;  /* defaults filled in once frames are known */
+            break;
+        case OPT_LATENCY:
+            latency = 1;
+            break;
+        case OPT_LATENCY_COSTS: {
+            int v[5] = { 0, 0, 0, 0, costs.tlb_entries };
+            int n = 0;
+            end = optarg;
+            do {
+                if (parse_int(n ? end + 1 : end, &end, &v[n]) < 0) break;
+                n++;
+            } while (n < 5 && *end == ',');
+            if (n < 4 || *end || v[4] < 1) {
+                fprintf(stderr, "vmsim: bad latency costs '%s'\n", optarg);
+                goto out;
+            }
+            costs.hit = (uint64_t)v[0];
+            costs.walk = (uint64_t)v[1];
+            costs.fault = (uint64_t)v[2];
+            costs.reclaim = (uint64_t)v[3];
+            costs.tlb_entries = v[4];
+            latency = 1;
+            break;
+        }
+        case OPT_MEM_BUDGET:
+        case OPT_STATE_CAP:
+            if (parse_size(optarg, opt == OPT_MEM_BUDGET ? &mem_budget : &state_cap) < 0) {
+                fprintf(stderr, "vmsim: bad size '%s'\n", optarg);
+                goto out;
+            }
+            break;
+        case OPT_STACK_DISTANCE:
+            stack_list = optarg;
+            break;
+        case OPT_BELADY:
+            belady = 1;
+            break;
+        case OPT_FRAME_TABLE:
+            frame_table = 1;
+            break;
+        case OPT_HASHED_PT:
+            hashed_pt = 1;
+            break;
+        case OPT_PAGE_SIZES:
+            page_sizes = optarg;
+            break;
+        case OPT_THP:
+            thp = 1;
+            break;
+        case OPT_COMPACTION: {
+            static const char *const modes[] = { "none", "direct", "background" };
+            size_t len = strcspn(optarg, ",");
+            int m = 0;
+            while (m < 3 && (strlen(modes[m]) != len || strncmp(optarg, modes[m], len) != 0)) m++;
+            if (m == 3 || (optarg[len] && (m != VM_COMPACT_BACKGROUND ||
+                                           parse_int(optarg + len + 1, &end,
+                                                     &thp_params.compact_interval) < 0 ||
+                                           *end || thp_params.compact_interval < 1))) {
+                fprintf(stderr, "vmsim: bad compaction mode '%s'\n", optarg);
+                goto out;
+            }
+            thp_params.compact = m;
+            break;
+        }
+        case OPT_KSM:
+            ksm_path = optarg;
+            break;
+        case OPT_KSM_SCAN:
+            if (parse_int(optarg, &end, &ksm.scan_interval) < 0 || *end != ',' ||
+                parse_int(end + 1, &end, &ksm.pages_to_scan) < 0 || *end) {
+                fprintf(stderr, "vmsim: bad ksm scan '%s'\n", optarg);
+                goto out;
+            }
+            break;
+        case OPT_NESTED:
+            nested_arg = optarg;
+            break;
+        case OPT_BALLOON:
+            balloon_arg = optarg;
+            break;
+        case OPT_BALLOON_ADJUST:
+            if (parse_int(optarg, &end, &balloon.interval) < 0 || *end != ',' ||
+                parse_int(end + 1, &end, &balloon.step) < 0 || *end || balloon.interval < 1) {
+                fprintf(stderr, "vmsim: bad balloon adjustment '%s'\n", optarg);
+                goto out;
+            }
+            break;
+        case 'h':
+            usage(stdout);
+            status = 0;
+            goto out;
+        default:
+            usage(stderr);
+            goto out;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(stderr);
+        goto out;
+    }
+    if (thp && ((advise.huge_pages & (advise.huge_pages - 1)) ||
+                advise.huge_pages > 1 << VM_BUDDY_MAX_ORDER)) {
+        fprintf(stderr, "vmsim: --thp needs --huge-pages to be a power of two up to %d\n",
+                1 << VM_BUDDY_MAX_ORDER);
+        goto out;
+    }
+
+    const struct vm_policy_ops *policies[MAX_POLICIES];
+    int npolicies;
+    int *frames = NULL;
+    int nframes;
+    if (parse_policies(policy_arg, plugins, nplugins, policies, &npolicies) < 0) goto out;
+    if (parse_frames(frames_arg, &frames, &nframes) < 0) {
+        fprintf(stderr, "vmsim: bad frame list '%s'\n", frames_arg);
+        goto out;
+    }
+
+    int host_frames = 0;
+    const struct vm_policy_ops *host_policy = vm_policy_find("lru");
+    if (nested_arg) {
+        if (parse_int(nested_arg, &end, &host_frames) < 0 || host_frames < 1 ||
+            (*end && *end != ',')) {
+            fprintf(stderr, "vmsim: bad nested spec '%s'\n", nested_arg);
+            free(frames);
+            goto out;
+        }
+        if (*end && !(host_policy = lookup_policy(end + 1, plugins, nplugins))) {
+            fprintf(stderr, "vmsim: unknown policy '%s'\n", end + 1);
+            free(frames);
+            goto out;
+        }
+    }
+
+    int guests = 0, balloon_host_frames = 0;
+    const struct vm_policy_ops *balloon_host = vm_policy_find("lru");
+    if (balloon_arg) {
+        if (parse_int(balloon_arg, &end, &guests) < 0 || guests < 1 || *end != ',' ||
+            parse_int(end + 1, &end, &balloon_host_frames) < 0 ||
+            balloon_host_frames < guests || (*end && *end != ',')) {
+            fprintf(stderr, "vmsim: bad balloon spec '%s'\n", balloon_arg);
+            free(frames);
+            goto out;
+        }
+        if (*end && !(balloon_host = lookup_policy(end + 1, plugins, nplugins))) {
+            fprintf(stderr, "vmsim: unknown policy '%s'\n", end + 1);
+            free(frames);
+            goto out;
+        }
+    }
+
+    if (thp && advise.huge_pages > frames[0])
+        fprintf(stderr, "vmsim: warning: --huge-pages %d exceeds %d frames, --thp maps base "
+                "pages only\n", advise.huge_pages, frames[0]);
+
+    if (page_sizes) {
+        status = run_page_sizes(argv[optind], page_sizes, frames[0]) < 0;
+        free(frames);
+        goto out;
+    }
+
+    struct trace t;
+    if (load_trace(argv[optind], &t) < 0) {
+        free(frames);
+        goto out;
+    }
+
+    struct job_queue q;
+    q.njobs = npolicies * nframes;
+    q.jobs = calloc((size_t)q.njobs, sizeof(struct job));
+    q.next = 0;
+    q.trace = &t;
+    q.table_cnt = table_cnt >= 0 ? table_cnt : t.table_cnt;
+    q.state_cap = state_cap;
+    q.budget = mem_budget;
+    q.in_use = 0;
+    pthread_mutex_init(&q.lock, NULL);
+    pthread_cond_init(&q.room, NULL);
+    if (!q.jobs) {
+        fprintf(stderr, "vmsim: out of memory\n");
+    } else {
+        for (int p = 0; p < npolicies; ++p) {
+            for (int f = 0; f < nframes; ++f) {
+                q.jobs[p * nframes + f].ops = policies[p];
+                q.jobs[p * nframes + f].frames = frames[f];
+                q.jobs[p * nframes + f].bytes =
+                    vm_policy_footprint(policies[p], q.table_cnt, frames[f], state_cap);
+            }
+        }
+        run_jobs(&q, nthreads);
+
+        printf("# %d references, %d pages, %d threads, %s kernels\n", t.count, q.table_cnt,
+               nthreads, vm_simd_variant());
+        printf("%-10s %8s %12s %10s %12s %10s\n", "policy", "frames", "faults", "hit_ratio",
+               "time_ms", "mem_kb");
+        status = 0;
+        for (int i = 0; i < q.njobs; ++i) {
+            const struct job *j = &q.jobs[i];
+            if (j->faults < 0) {
+                printf("%-10s %8d %12s\n", j->ops->name, j->frames, "error");
+                status = 1;
+                continue;
+            }
+            double hit = t.count ? 1.0 - (double)j->faults / t.count : 0.0;
+            printf("%-10s %8d %12d %10.4f %12.3f %10.1f%s\n", j->ops->name, j->frames, j->faults, hit,
+                   j->ms, j->bytes / 1024.0,
+                   vm_policy_compact(j->ops, q.table_cnt, j->frames, state_cap) ? " compact" : "");
+        }
+        if ((heatmap_path || advise_path) &&
+            run_analyses(&t, q.table_cnt, policies[0], frames[0], heatmap_path, advise_path,
+                         &advise) < 0)
+            status = 1;
+        if (phase_interval &&
+            run_phases(&t, q.table_cnt, policies, npolicies, frames[0], phase_interval,
+                       phase_threshold) < 0)
+            status = 1;
+        if ((cgroup.high || cgroup.max) &&
+            run_cgroup(&t, q.table_cnt, policies, npolicies, frames[0], &cgroup) < 0)
+            status = 1;
+        if (kswapd.low >= 0) {
+            if (kswapd.high < 0) {
+                double rate = kswapd.rate;
+                vm_kswapd_defaults(&kswapd, frames[0]);
+                kswapd.rate = rate;
+            }
+            if (run_kswapd(&t, q.table_cnt, policies, npolicies, frames[0], &kswapd) < 0)
+                status = 1;
+        }
+        if (latency &&
+            run_latency(&t, q.table_cnt, policies, npolicies, frames[0], &costs) < 0)
+            status = 1;
+        if (stack_list && run_stack_distance(&t, q.table_cnt, stack_list, frames, nframes) < 0)
+            status = 1;
+        if (belady && run_belady(&t, q.table_cnt, frames, nframes, nthreads) < 0)
+            status = 1;
+        if (frame_table &&
+            run_frame_table(&t, q.table_cnt, policies, npolicies, frames[0]) < 0)
+            status = 1;
+        if (hashed_pt && run_hashed_pt(&t, q.table_cnt, frames[0]) < 0)
+            status = 1;
+        if (thp && run_thp(&t, q.table_cnt, policies, npolicies, frames[0], advise.huge_pages,
+                           &thp_params) < 0)
+            status = 1;
+        if (ksm_path &&
+            run_ksm(&t, q.table_cnt, policies, npolicies, frames[0], ksm_path, &ksm) < 0)
+            status = 1;
+        if (nested_arg && run_nested(&t, q.table_cnt, policies, npolicies, frames[0],
+                                     host_policy, host_frames, costs.tlb_entries) < 0)
+            status = 1;
+        if (balloon_arg && run_balloon(&t, q.table_cnt, policies, npolicies, frames[0], guests,
+                                       balloon_host, balloon_host_frames, &costs, &balloon) < 0)
+            status = 1;
+    }
+    pthread_cond_destroy(&q.room);
+    pthread_mutex_destroy(&q.lock);
+    free(q.jobs);
+    free(frames);
+    free(t.refs);
+
+out:
+    for (int i = 0; i < nplugins; ++i) vm_plugin_unload(&plugins[i]);
+    return status;
+}